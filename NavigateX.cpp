@@ -8,17 +8,41 @@
 // 4. Linked List - O(n) operations
 // 5. Queue (FIFO) - O(1) operations
 // 6. AVL Tree - O(log n) balanced operations
-// 7. Custom Hash Table - O(1) average with chaining
+// 7. Custom Hash Table - O(1) average with chaining, or Robin Hood open addressing
+// 8. String Interner - Arena-backed symbol table shared by all structures
+// 9. Write-Ahead Log - Group-committed, checksummed log with snapshots
+// 10. LOUDS Trie - Immutable succinct trie, memory-mappable
+// 11. Infix Index - Trigram inverted index for substring search
 // ===================================================================
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <cctype>
 #include <limits>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 using namespace std;
 
@@ -29,6 +53,506 @@ string toLower(string s) {
     return s;
 }
 
+// ===================================================================
+// STRING INTERNER - Arena-backed Symbol Table
+// Time Complexity: O(m) intern/find where m is string length, O(1) view
+// ===================================================================
+
+// Compact handle for an interned string. Symbols compare as integers, so
+// structures that share an interner never compare names character by character.
+using Symbol = uint32_t;
+const Symbol NO_SYMBOL = numeric_limits<Symbol>::max();
+
+// Thread-safe: intern()/find() take an internal lock, while view() is
+// lock-free because symbol slots live in fixed pages that never move.
+class StringInterner {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    static constexpr size_t PAGE_BITS = 12;
+    static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+    static constexpr size_t MAX_PAGES = size_t(1) << 14;  // 64M symbols
+
+    vector<unique_ptr<char[]>> blocks;
+    size_t blockUsed;
+    size_t blockCapacity;
+    size_t bytes;
+    unique_ptr<unique_ptr<string_view[]>[]> pages;
+    atomic<Symbol> count;
+    unordered_map<string_view, Symbol> lookup;
+    mutable shared_mutex lock;
+
+    // Copies s into the arena. Blocks are never moved or freed while the
+    // interner lives, so the returned view stays valid.
+    string_view store(string_view s) {
+        if (s.size() > blockCapacity - blockUsed) {
+            size_t cap = max(BLOCK_SIZE, s.size());
+            blocks.push_back(unique_ptr<char[]>(new char[cap]));
+            blockUsed = 0;
+            blockCapacity = cap;
+        }
+        char* dst = blocks.back().get() + blockUsed;
+        if (!s.empty()) {
+            memcpy(dst, s.data(), s.size());
+        }
+        blockUsed += s.size();
+        bytes += s.size();
+        return string_view(dst, s.size());
+    }
+
+    // Caller holds the exclusive lock
+    Symbol insertLocked(string_view s) {
+        auto it = lookup.find(s);
+        if (it != lookup.end()) {
+            return it->second;
+        }
+        Symbol sym = count.load(memory_order_relaxed);
+        size_t page = sym >> PAGE_BITS;
+        if (page >= MAX_PAGES) {
+            return NO_SYMBOL;
+        }
+        if (!pages[page]) {
+            pages[page].reset(new string_view[PAGE_SIZE]);
+        }
+        string_view stored = store(s);
+        pages[page][sym & (PAGE_SIZE - 1)] = stored;
+        lookup.emplace(stored, sym);
+        count.store(sym + 1, memory_order_release);
+        return sym;
+    }
+
+public:
+    StringInterner()
+        : blockUsed(0), blockCapacity(0), bytes(0),
+          pages(new unique_ptr<string_view[]>[MAX_PAGES]), count(0) {}
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    // Returns NO_SYMBOL once all symbol pages are in use; callers must
+    // check before storing or indexing by the result
+    Symbol intern(string_view s) {
+        {
+            shared_lock<shared_mutex> read(lock);
+            auto it = lookup.find(s);
+            if (it != lookup.end()) {
+                return it->second;
+            }
+        }
+        unique_lock<shared_mutex> write(lock);
+        return insertLocked(s);
+    }
+
+    // Interns s[0..n) into out, taking the shared lock once for all the
+    // hits and the exclusive lock once for all the misses. Returns false if
+    // the interner fills up, leaving NO_SYMBOL from that string on.
+    bool internAll(const string_view* s, size_t n, Symbol* out) {
+        size_t missing = 0;
+        {
+            shared_lock<shared_mutex> read(lock);
+            for (size_t i = 0; i < n; i++) {
+                auto it = lookup.find(s[i]);
+                out[i] = (it != lookup.end()) ? it->second : NO_SYMBOL;
+                missing += out[i] == NO_SYMBOL;
+            }
+        }
+        if (missing == 0) {
+            return true;
+        }
+        unique_lock<shared_mutex> write(lock);
+        for (size_t i = 0; i < n; i++) {
+            if (out[i] != NO_SYMBOL) continue;
+            out[i] = insertLocked(s[i]);
+            if (out[i] == NO_SYMBOL) {
+                fill(out + i, out + n, NO_SYMBOL);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns NO_SYMBOL instead of interning unknown strings
+    Symbol find(string_view s) const {
+        shared_lock<shared_mutex> read(lock);
+        auto it = lookup.find(s);
+        return (it != lookup.end()) ? it->second : NO_SYMBOL;
+    }
+
+    string_view view(Symbol sym) const {
+        return pages[sym >> PAGE_BITS][sym & (PAGE_SIZE - 1)];
+    }
+
+    int size() const { return count.load(memory_order_acquire); }
+    size_t arenaBytes() const {
+        shared_lock<shared_mutex> read(lock);
+        return bytes;
+    }
+};
+
+// Process-wide interner used by default, so locations, stops and trie
+// words with the same spelling share one copy and one symbol.
+StringInterner& sharedInterner() {
+    static StringInterner names;
+    return names;
+}
+
+// Case-insensitive hashing/equality for string_view keys (ASCII folding)
+struct FoldedHash {
+    size_t operator()(string_view s) const {
+        size_t hash = 5381;
+        for (char c : s) {
+            hash = ((hash << 5) + hash) + (unsigned char)tolower((unsigned char)c);
+        }
+        return hash;
+    }
+};
+
+struct FoldedEqual {
+    bool operator()(string_view a, string_view b) const {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// ===================================================================
+// WRITE-AHEAD LOG - Durable Graph, Route and Traffic Mutations
+// Mutations are appended as checksummed binary records before they are
+// applied. Concurrent commits share one fdatasync (group commit), and a
+// periodic snapshot of the full state lets the log be truncated, so a
+// restart costs one snapshot load plus a short sequential replay.
+// Time Complexity: O(1) append, O(records) replay
+// ===================================================================
+
+class Graph;
+class BusRouteManager;
+class TrafficManager;
+
+enum LogRecordType : uint8_t {
+    LOG_ADD_LOCATION = 1,
+    LOG_ADD_EDGE,
+    LOG_ADD_ROUTE,
+    LOG_DELETE_ROUTE,
+    LOG_REVERSE_ROUTE,
+    LOG_APPEND_STOP,
+    LOG_INSERT_STOP,  // c = anchor stop, value = its occurrence on the route, flag = after
+    LOG_ERASE_STOP,   // b = erased stop, value = its occurrence on the route
+    LOG_TRAFFIC,      // value = TrafficLevel
+    LOG_SNAPSHOT      // first record of a snapshot; value = last LSN it covers
+};
+
+// Decoded record. Names are views into the buffer being replayed.
+struct LogRecord {
+    uint64_t lsn;
+    LogRecordType type;
+    uint8_t flag;
+    int64_t value;
+    string_view a;  // location or route name
+    string_view b;  // second location or stop name
+    string_view c;  // anchor stop name
+};
+
+// What recover() found on disk
+struct RecoveryStats {
+    long snapshotRecords;
+    long logRecords;      // applied from the log after the snapshot
+    long truncatedBytes;  // torn or corrupt tail dropped from the log
+};
+
+// Records are framed as [u32 payload length][u32 CRC-32 of payload], the
+// payload holding the LSN, type, flag, a zigzag varint value and three
+// length-prefixed names. Replay stops at the first short or corrupt frame.
+class WriteAheadLog {
+private:
+    string logPath;
+    string snapshotPath;
+    int fd;
+
+    mutex m;
+    condition_variable flushed;
+    string pending;       // encoded records not yet written
+    uint64_t lastLsn;     // LSN of the newest appended record
+    uint64_t durableLsn;  // every record up to here is on disk
+    bool flushing;        // a leader is writing and syncing outside the lock
+    bool failed;
+    long syncCount;
+    long recordCount;
+
+    thread flusher;
+    condition_variable flusherWake;
+    bool stopping;
+
+    static const uint32_t* crcTable() {
+        static uint32_t table[256];
+        static bool built = [] {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                table[i] = c;
+            }
+            return true;
+        }();
+        (void)built;
+        return table;
+    }
+
+    static uint32_t crc32(const char* data, size_t n) {
+        const uint32_t* table = crcTable();
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < n; i++) {
+            c = table[(c ^ (uint8_t)data[i]) & 0xFF] ^ (c >> 8);
+        }
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    static void putVarint(string &out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+
+    static bool getVarint(const char* &p, const char* end, uint64_t &v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t byte = *p++;
+            v |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    static void putFixed32(char* p, uint32_t v) {
+        for (int i = 0; i < 4; i++) p[i] = (char)(v >> (8 * i));
+    }
+
+    static uint32_t getFixed32(const char* p) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= (uint32_t)(uint8_t)p[i] << (8 * i);
+        return v;
+    }
+
+    static void encode(string &out, uint64_t lsn, LogRecordType type, string_view a,
+                       string_view b, int64_t value, uint8_t flag, string_view c = {}) {
+        size_t frame = out.size();
+        out.append(8, '\0');
+        putVarint(out, lsn);
+        out.push_back((char)type);
+        out.push_back((char)flag);
+        putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+        putVarint(out, a.size());
+        out.append(a.data(), a.size());
+        putVarint(out, b.size());
+        out.append(b.data(), b.size());
+        putVarint(out, c.size());
+        out.append(c.data(), c.size());
+        size_t len = out.size() - frame - 8;
+        putFixed32(&out[frame], (uint32_t)len);
+        putFixed32(&out[frame + 4], crc32(&out[frame + 8], len));
+    }
+
+    // Decodes the frame at p; false on a short or corrupt frame
+    static bool decode(const char* &p, const char* end, LogRecord &r) {
+        if (end - p < 8) return false;
+        uint32_t len = getFixed32(p);
+        const char* body = p + 8;
+        if ((size_t)(end - body) < len || crc32(body, len) != getFixed32(p + 4)) return false;
+        const char* q = body;
+        const char* bodyEnd = body + len;
+        uint64_t lsn, zz, alen, blen, clen;
+        if (!getVarint(q, bodyEnd, lsn) || bodyEnd - q < 2) return false;
+        r.lsn = lsn;
+        r.type = (LogRecordType)(uint8_t)*q++;
+        r.flag = (uint8_t)*q++;
+        if (!getVarint(q, bodyEnd, zz)) return false;
+        r.value = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+        if (!getVarint(q, bodyEnd, alen) || (uint64_t)(bodyEnd - q) < alen) return false;
+        r.a = string_view(q, alen);
+        q += alen;
+        if (!getVarint(q, bodyEnd, blen) || (uint64_t)(bodyEnd - q) < blen) return false;
+        r.b = string_view(q, blen);
+        q += blen;
+        if (!getVarint(q, bodyEnd, clen) || (uint64_t)(bodyEnd - q) < clen) return false;
+        r.c = string_view(q, clen);
+        p = bodyEnd;
+        return true;
+    }
+
+    static bool readFile(const string &path, string &out) {
+        out.clear();
+        int in = ::open(path.c_str(), O_RDONLY);
+        if (in < 0) return false;
+        char buf[1 << 16];
+        ssize_t n;
+        while ((n = ::read(in, buf, sizeof(buf))) > 0) {
+            out.append(buf, n);
+        }
+        ::close(in);
+        return n == 0;
+    }
+
+    static bool writeAll(int out, const char* data, size_t n) {
+        while (n > 0) {
+            ssize_t w = ::write(out, data, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += w;
+            n -= w;
+        }
+        return true;
+    }
+
+    // Decodes records from buf in order; returns the length of the valid
+    // prefix
+    template <typename F>
+    static size_t scan(const string &buf, F visit) {
+        const char* p = buf.data();
+        const char* end = p + buf.size();
+        LogRecord r;
+        while (p < end) {
+            const char* start = p;
+            if (!decode(p, end, r)) return start - buf.data();
+            visit(r);
+        }
+        return buf.size();
+    }
+
+    void applyRecord(const LogRecord &r, Graph &graph, BusRouteManager &routes,
+                     TrafficManager &traffic);
+
+public:
+    // Opens (or creates) basePath.wal; the snapshot is basePath.snap. With
+    // flushIntervalMs > 0 a background thread commits on that period, so
+    // callers that never commit lose at most one interval on a crash.
+    WriteAheadLog(const string &basePath, int flushIntervalMs = 0)
+        : logPath(basePath + ".wal"), snapshotPath(basePath + ".snap"),
+          lastLsn(0), durableLsn(0), flushing(false), failed(false),
+          syncCount(0), recordCount(0), stopping(false) {
+        fd = ::open(logPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        failed = fd < 0;
+        if (flushIntervalMs > 0 && !failed) {
+            flusher = thread([this, flushIntervalMs]() {
+                unique_lock<mutex> lock(m);
+                while (!stopping) {
+                    flusherWake.wait_for(lock, chrono::milliseconds(flushIntervalMs));
+                    uint64_t upTo = lastLsn;
+                    lock.unlock();
+                    commit(upTo);
+                    lock.lock();
+                }
+            });
+        }
+    }
+
+    ~WriteAheadLog() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        flusherWake.notify_all();
+        if (flusher.joinable()) flusher.join();
+        commit();
+        if (fd >= 0) ::close(fd);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    bool isOpen() const { return fd >= 0; }
+
+    // Buffers one record and returns its LSN; durable after commit(lsn).
+    // Thread-safe.
+    uint64_t append(LogRecordType type, string_view a, string_view b = {},
+                    int64_t value = 0, uint8_t flag = 0, string_view c = {}) {
+        lock_guard<mutex> lock(m);
+        encode(pending, ++lastLsn, type, a, b, value, flag, c);
+        recordCount++;
+        return lastLsn;
+    }
+
+    // Blocks until every record up to lsn is on disk. The first waiter
+    // writes and syncs everything buffered so far while later callers
+    // wait for it, so concurrent commits cost one fdatasync between them.
+    bool commit(uint64_t lsn) {
+        unique_lock<mutex> lock(m);
+        string out;
+        while (durableLsn < lsn && !failed) {
+            if (flushing) {
+                flushed.wait(lock);
+                continue;
+            }
+            flushing = true;
+            out.swap(pending);
+            uint64_t upTo = lastLsn;
+            lock.unlock();
+            bool ok = writeAll(fd, out.data(), out.size()) && ::fdatasync(fd) == 0;
+            lock.lock();
+            flushing = false;
+            failed = !ok;
+            durableLsn = upTo;
+            syncCount++;
+            if (pending.empty()) {
+                out.clear();
+                pending.swap(out);  // keep the buffer's capacity
+            }
+            flushed.notify_all();
+        }
+        return !failed;
+    }
+
+    bool commit() {
+        uint64_t upTo;
+        {
+            lock_guard<mutex> lock(m);
+            upTo = lastLsn;
+        }
+        return commit(upTo);
+    }
+
+    // Loads the snapshot, then replays log records newer than it and drops
+    // a torn tail so appends continue after the last good record. Call once
+    // at startup, before attaching the log to the structures.
+    bool recover(Graph &graph, BusRouteManager &routes, TrafficManager &traffic,
+                 RecoveryStats* stats = nullptr);
+
+    // Writes a snapshot of the full state and truncates the log. Call from
+    // the thread that mutates the graph and routes and drains traffic (or
+    // with those paused), so no mutation is half-logged.
+    bool checkpoint(const Graph &graph, const BusRouteManager &routes, const TrafficManager &traffic);
+
+    uint64_t lastAppendedLsn() {
+        lock_guard<mutex> lock(m);
+        return lastLsn;
+    }
+
+    long syncs() {
+        lock_guard<mutex> lock(m);
+        return syncCount;
+    }
+
+    long records() {
+        lock_guard<mutex> lock(m);
+        return recordCount;
+    }
+
+    // On-disk size of the log
+    long logBytes() const {
+        struct stat st;
+        return (fd >= 0 && ::fstat(fd, &st) == 0) ? (long)st.st_size : 0;
+    }
+
+    const string &logFile() const { return logPath; }
+    const string &snapshotFile() const { return snapshotPath; }
+};
+
 // ===================================================================
 // HASH MAP - User Storage using unordered_map
 // Time Complexity: O(1) average for all operations
@@ -75,1121 +599,6431 @@ public:
 
 // ===================================================================
 // TRIE - Prefix Tree for Location Auto-Complete
-// Time Complexity: O(m) insert/search where m is word length
+// Keys are case-folded UTF-8 bytes. Siblings sit next to each other in one
+// node arena sorted by the byte on their incoming edge, so a node stores
+// only its first child and child count whatever the alphabet: small
+// fan-outs are scanned, wide ones binary searched.
+// Time Complexity: O(m log f) insert/search for m key bytes and fan-out f
 // ===================================================================
 
-class TrieNode {
-public:
-    bool isEnd;
-    TrieNode* children[26];
+// Simple one-to-one case folding for the scripts in our gazetteer:
+// Latin-1, Latin Extended-A, Greek and Cyrillic
+uint32_t foldCodepoint(uint32_t cp) {
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 0x20;
+    if (cp >= 0x100 && cp <= 0x17F) {
+        if (cp == 0x178) return 0xFF;
+        bool oddUpper = (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E);
+        bool upper = (cp == 0x130) ? false : oddUpper ? (cp & 1) : !(cp & 1);
+        return (upper && cp != 0x138 && cp != 0x149) ? cp + 1 : cp;
+    }
+    if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) return cp + 0x20;
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+    return cp;
+}
+
+void appendUtf8(string &out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back((char)cp);
+    } else if (cp < 0x800) {
+        out.push_back((char)(0xC0 | (cp >> 6)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((char)(0xE0 | (cp >> 12)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | (cp >> 18)));
+        out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Appends the search key for text: ASCII letters and digits lower-cased,
+// ASCII spaces and punctuation dropped, other characters case-folded and
+// kept. Malformed UTF-8 bytes pass through unchanged.
+void appendFoldedKey(string_view text, string &out) {
+    for (size_t i = 0; i < text.size();) {
+        uint8_t b = text[i];
+        if (b < 0x80) {
+            if (isalnum(b)) out.push_back((char)tolower(b));
+            i++;
+            continue;
+        }
+        size_t len = (b >= 0xF0) ? 4 : (b >= 0xE0) ? 3 : (b >= 0xC0) ? 2 : 1;
+        uint32_t cp = b & (0x7F >> len);
+        bool valid = len > 1 && i + len <= text.size();
+        for (size_t k = 1; valid && k < len; k++) {
+            uint8_t c = text[i + k];
+            valid = (c & 0xC0) == 0x80;
+            cp = (cp << 6) | (c & 0x3F);
+        }
+        if (!valid) {
+            out.push_back((char)b);
+            i++;
+            continue;
+        }
+        appendUtf8(out, foldCodepoint(cp));
+        i += len;
+    }
+}
+
+// Byte-at-a-time UTF-8 decoder, for stepping through byte-keyed tries one
+// character at a time. A sequence cut short by a non-continuation byte is
+// dropped; other stray bytes decode as themselves.
+struct Utf8Decoder {
+    uint32_t cp = 0;
+    int pending = 0;  // continuation bytes still expected
+
+    // True when b completes a character, which is then in cp
+    bool feed(uint8_t b) {
+        if (pending > 0 && (b & 0xC0) == 0x80) {
+            cp = (cp << 6) | (b & 0x3F);
+            return --pending == 0;
+        }
+        if (b >= 0xC0) {
+            pending = (b >= 0xF0) ? 3 : (b >= 0xE0) ? 2 : 1;
+            cp = b & (0x3F >> pending);
+            return false;
+        }
+        pending = 0;
+        cp = b;
+        return true;
+    }
+};
+
+// Payload of a word inserted without one
+const uint32_t NO_PAYLOAD = numeric_limits<uint32_t>::max();
+
+// 24 bytes whatever the alphabet, against 26 pointers per node in a
+// pointer-per-letter trie (or 256 for full bytes). Readers run alongside
+// the writer: children are published by a single store to firstChild, and
+// each child records the length of its sibling run, so one acquire load
+// yields a complete run.
+struct TrieNode {
+    atomic<uint32_t> firstChild;  // arena index of the child with the lowest label, 0 if none
+    atomic<Symbol> word;          // interned original spelling of the word ending here, or NO_SYMBOL
+    atomic<uint32_t> score;       // popularity of that word
+    atomic<uint32_t> maxScore;    // highest word score in this subtree, for top-k pruning
+    atomic<uint32_t> payload;     // caller's id for that word (e.g. a Graph node id)
+    uint16_t runLength;           // nodes in this node's sibling run, itself included
+    uint8_t label;                // key byte on the edge from the parent
+    atomic<uint8_t> version;      // seqlock over word, score and payload: odd while they are rewritten
+
+    TrieNode()
+        : firstChild(0), word(NO_SYMBOL), score(0), maxScore(0), payload(NO_PAYLOAD), runLength(0), label(0),
+          version(0) {}
+
+    Symbol wordSymbol() const { return word.load(memory_order_acquire); }
+    bool isEnd() const { return wordSymbol() != NO_SYMBOL; }
+};
+
+// Caller-owned suggestion output: keys are packed back to back in one
+// buffer and addressed by (offset, length), so a buffer reused across
+// calls makes suggest() allocation-free once it has grown to size
+struct SuggestionBuffer {
+    string chars;
+    vector<pair<uint32_t, uint32_t>> spans;
 
-    TrieNode() {
-        isEnd = false;
-        fill(begin(children), end(children), nullptr);
+    void clear() {
+        chars.clear();
+        spans.clear();
+    }
+
+    void add(string_view key) {
+        spans.push_back({(uint32_t)chars.size(), (uint32_t)key.size()});
+        chars.append(key.data(), key.size());
+    }
+
+    size_t size() const { return spans.size(); }
+    string_view operator[](size_t i) const {
+        return string_view(chars).substr(spans[i].first, spans[i].second);
     }
 };
 
+// A ranked suggestion: the inserted spelling, the payload stored with it
+// and its score
+struct TrieMatch {
+    Symbol word;
+    uint32_t payload;
+    uint32_t score;
+};
+
+// Safe for one writer at a time alongside any number of readers. Readers
+// take no lock: the arena is paged so nodes never move, a node gaining a
+// child gets a new sibling run published with one atomic store, and the
+// run it replaced is only reused once every reader that could still be
+// inside it has left.
 class Trie {
 private:
-    TrieNode* root;
+    friend class LoudsTrie;
+
+    static constexpr int MAX_FANOUT = 256;
+    static constexpr int SCAN_FANOUT = 16;  // wider sibling runs are binary searched
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NO_NODE = numeric_limits<uint32_t>::max();
+    // The first page holds one widest sibling run and each following
+    // page doubles, up to PAGE_SIZE; from there every page is PAGE_SIZE.
+    // A small trie thus stays a few KB, and only a trie past the small
+    // pages allocates the large page table.
+    static constexpr size_t FIRST_PAGE_BITS = 8;
+    static constexpr size_t FIRST_PAGE_SIZE = size_t(1) << FIRST_PAGE_BITS;
+    static constexpr size_t PAGE_BITS = 16;
+    static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+    static constexpr size_t SMALL_PAGES = PAGE_BITS - FIRST_PAGE_BITS;  // 256 .. 32k nodes
+    static constexpr size_t LARGE_PAGES = 4096;                          // 256M nodes
+    static_assert(FIRST_PAGE_SIZE >= MAX_FANOUT, "a sibling run must fit in any page");
+
+    // Page of an arena index, the index's offset in it and the page length
+    struct PagePos {
+        size_t page;
+        size_t offset;
+        size_t length;
+    };
 
-    int idx(char c) {
-        if (isalpha(c)) {
-            return tolower(c) - 'a';
+    // Shifted by FIRST_PAGE_SIZE, small page p covers [2^(8+p), 2^(9+p))
+    // and large pages follow in PAGE_SIZE steps
+    static PagePos locate(uint32_t i) {
+        size_t k = (size_t)i + FIRST_PAGE_SIZE;
+        if (k < PAGE_SIZE) {
+            size_t bit = 63 - __builtin_clzll(k);
+            return {bit - FIRST_PAGE_BITS, k - (size_t(1) << bit), size_t(1) << bit};
         }
-        return -1;
+        return {SMALL_PAGES + (k >> PAGE_BITS) - 1, k & (PAGE_SIZE - 1), PAGE_SIZE};
     }
 
-    void collectAll(TrieNode* node, string prefix, vector<string> &out) {
-        if (!node) return;
-        
-        if (node->isEnd) {
-            out.push_back(prefix);
-        }
+    // Node arena; index ROOT is the root. A sibling run never straddles
+    // two pages.
+    atomic<TrieNode*> smallPages[SMALL_PAGES];
+    atomic<atomic<TrieNode*>*> largePages;  // LARGE_PAGES slots, allocated on first use
+    atomic<size_t> pageCount;
+    atomic<size_t> liveNodes;
+    uint32_t arenaEnd;  // first index never handed out
+    // Sibling runs ready for reuse, by run length
+    vector<uint32_t> freeRuns[MAX_FANOUT + 1];
+    StringInterner* names;
 
-        for (int i = 0; i < 26; i++) {
-            if (node->children[i]) {
-                collectAll(node->children[i], prefix + char('a' + i), out);
-            }
+    // Deferred reuse of replaced runs. Readers count themselves in the
+    // slot of the epoch they entered; a run retired during epoch e goes on
+    // retired[e & 1] and becomes free once that slot's readers have all
+    // left, at which point the epoch advances and the slots alternate.
+    atomic<uint64_t> epoch;
+    alignas(64) mutable atomic<long> readers[2];
+    alignas(64) vector<pair<uint32_t, uint32_t>> retired[2];  // (run, length)
+
+    // Writer state: inserts are serialized
+    mutable mutex writeLock;
+    vector<uint32_t> path;
+    string insertKey;
+
+    // Best-first frontier for top-k queries: a subtree keyed by its best
+    // score, or a word keyed by its own. Fuzzy queries put the edit rank
+    // above the score (fewer edits rank higher).
+    struct Candidate {
+        uint64_t key;
+        uint32_t node;
+        bool isWord;
+
+        bool operator<(const Candidate &o) const {
+            if (key != o.key) return key < o.key;
+            return !isWord && o.isWord;  // on ties emit words before expanding
         }
+    };
+
+    // Parked level of a depth-first walk: its next sibling and the
+    // siblings left
+    struct WalkFrame {
+        const TrieNode* next;
+        uint32_t left;
+    };
+
+    // Traversal scratch, one per thread so concurrent readers share
+    // nothing mutable: parked walk levels, the key buffer rewritten in
+    // place, the top-k frontier and the fuzzy automaton (the folded query
+    // as characters and one row of edit distances per key character
+    // matched, saturated at editCap). Reused across calls, so steady-state
+    // queries allocate nothing.
+    struct QueryState {
+        vector<WalkFrame> walk;
+        string key;
+        vector<Candidate> frontier;
+        vector<uint32_t> query;
+        vector<uint8_t> rows;
+        uint8_t editCap = 0;
+    };
+
+    static QueryState& queryState() {
+        static thread_local QueryState state;
+        return state;
     }
 
-    void destroyTrie(TrieNode* node) {
-        if (!node) return;
-        for (int i = 0; i < 26; i++) {
-            if (node->children[i]) {
-                destroyTrie(node->children[i]);
+    // Registers a reader for its lifetime, holding off reuse of any run
+    // it might still reach
+    class ReadGuard {
+    private:
+        const Trie &trie;
+        int slot;
+
+    public:
+        explicit ReadGuard(const Trie &t) : trie(t) {
+            for (;;) {
+                uint64_t e = trie.epoch.load();
+                slot = e & 1;
+                trie.readers[slot].fetch_add(1);
+                if (trie.epoch.load() == e) break;
+                trie.readers[slot].fetch_sub(1);  // the epoch moved on: count in the new slot
             }
         }
-        delete node;
+
+        ~ReadGuard() { trie.readers[slot].fetch_sub(1, memory_order_release); }
+    };
+
+    // A node's children: the first child, its arena index and the count
+    struct Run {
+        const TrieNode* first;
+        uint32_t index;
+        uint32_t count;
+    };
+
+    TrieNode &at(uint32_t i) const {
+        PagePos pos = locate(i);
+        const atomic<TrieNode*> &page = (pos.page < SMALL_PAGES)
+            ? smallPages[pos.page]
+            : largePages.load(memory_order_acquire)[pos.page - SMALL_PAGES];
+        return page.load(memory_order_acquire)[pos.offset];
     }
 
-public:
-    Trie() {
-        root = new TrieNode();
+    // Writer only: the slot for a page pointer, creating the large page
+    // table the first time it is needed
+    atomic<TrieNode*> &pageSlot(size_t page) {
+        if (page < SMALL_PAGES) return smallPages[page];
+        atomic<TrieNode*>* table = largePages.load(memory_order_relaxed);
+        if (!table) {
+            table = new atomic<TrieNode*>[LARGE_PAGES];
+            for (size_t p = 0; p < LARGE_PAGES; p++) table[p].store(nullptr, memory_order_relaxed);
+            largePages.store(table, memory_order_release);
+        }
+        return table[page - SMALL_PAGES];
     }
 
-    ~Trie() {
-        destroyTrie(root);
+    // Nodes in the first `pages` pages
+    static size_t arenaCapacity(size_t pages) {
+        if (pages <= SMALL_PAGES) return (FIRST_PAGE_SIZE << pages) - FIRST_PAGE_SIZE;
+        return PAGE_SIZE - FIRST_PAGE_SIZE + (pages - SMALL_PAGES) * PAGE_SIZE;
     }
 
-    void insert(const string &word) {
-        TrieNode* cur = root;
-        
-        for (char c : word) {
-            int i = idx(c);
-            if (i == -1) continue;
+    // Acquire pairs with the release in addChild: the run is fully written
+    Run children(const TrieNode &n) const {
+        uint32_t first = n.firstChild.load(memory_order_acquire);
+        if (first == 0) return {nullptr, 0, 0};
+        const TrieNode* run = &at(first);
+        return {run, first, run->runLength};
+    }
 
-            if (!cur->children[i]) {
-                cur->children[i] = new TrieNode();
-            }
-            cur = cur->children[i];
+    // Position within run where label is or would be inserted
+    static uint32_t childRank(const Run &run, uint8_t label) {
+        uint32_t count = run.count;
+        if (count <= SCAN_FANOUT) {
+            uint32_t k = 0;
+            while (k < count && run.first[k].label < label) k++;
+            return k;
         }
-        
-        cur->isEnd = true;
+        uint32_t lo = 0, hi = count;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (run.first[mid].label < label) lo = mid + 1; else hi = mid;
+        }
+        return lo;
     }
 
-    vector<string> suggest(const string &prefix) {
-        TrieNode* cur = root;
-        string p;
+    // Index of the child reached by label, or NO_NODE
+    uint32_t child(uint32_t node, uint8_t label) const {
+        Run run = children(at(node));
+        uint32_t rank = childRank(run, label);
+        if (rank == run.count || run.first[rank].label != label) return NO_NODE;
+        return run.index + rank;
+    }
 
-        for (char c : prefix) {
-            int i = idx(c);
-            if (i == -1) continue;
+    // Arena index of n free nodes within one page, or NO_NODE when the
+    // arena is full
+    uint32_t allocateRun(uint32_t n) {
+        if (!freeRuns[n].empty()) {
+            uint32_t run = freeRuns[n].back();
+            freeRuns[n].pop_back();
+            return run;
+        }
+        PagePos pos = locate(arenaEnd);
+        if (pos.offset + n > pos.length) {
+            size_t tail = pos.length - pos.offset;
+            freeRuns[tail].push_back(arenaEnd);  // page tail, kept for a shorter run
+            arenaEnd += tail;
+            pos = locate(arenaEnd);
+        }
+        if (pos.page >= SMALL_PAGES + LARGE_PAGES) return NO_NODE;
+        atomic<TrieNode*> &page = pageSlot(pos.page);
+        if (!page.load(memory_order_relaxed)) {
+            page.store(new TrieNode[pos.length], memory_order_release);
+            pageCount.store(pos.page + 1, memory_order_relaxed);
+        }
+        uint32_t run = arenaEnd;
+        arenaEnd += n;
+        return run;
+    }
 
-            if (!cur->children[i]) {
-                return {};
+    // Copies node's children into a run one longer with an empty node
+    // labelled `label` in its sorted slot, then publishes it. Readers see
+    // the old run or the new one, never a mix; the old run is retired.
+    uint32_t addChild(uint32_t node, uint8_t label) {
+        TrieNode &parent = at(node);
+        Run old = children(parent);
+        uint32_t rank = childRank(old, label);
+        uint32_t count = old.count + 1;
+        uint32_t run = allocateRun(count);
+        if (run == NO_NODE) return NO_NODE;
+        TrieNode* dst = &at(run);
+        for (uint32_t k = 0, from = 0; k < count; k++) {
+            if (k == rank) {
+                TrieNode &d = dst[k];
+                d.firstChild.store(0, memory_order_relaxed);
+                d.word.store(NO_SYMBOL, memory_order_relaxed);
+                d.score.store(0, memory_order_relaxed);
+                d.maxScore.store(0, memory_order_relaxed);
+                d.payload.store(NO_PAYLOAD, memory_order_relaxed);
+                d.label = label;
+                d.runLength = count;
+                d.version.store(0, memory_order_relaxed);
+            } else {
+                copyNode(dst[k], old.first[from++], count);
             }
-            
-            cur = cur->children[i];
-            p.push_back(tolower(c));
         }
+        parent.firstChild.store(run, memory_order_release);
+        retire(old);
+        liveNodes.fetch_add(1, memory_order_relaxed);
+        return run + rank;
+    }
 
-        vector<string> out;
-        collectAll(cur, p, out);
-        return out;
+    // Publishes node's children without the one at rank, or no children
+    // if it was the only one. Returns false (leaving the child in place)
+    // only if the arena has no room for the shorter run.
+    bool removeChild(uint32_t node, uint32_t rank) {
+        TrieNode &parent = at(node);
+        Run old = children(parent);
+        uint32_t count = old.count - 1;
+        uint32_t run = 0;
+        if (count > 0) {
+            run = allocateRun(count);
+            if (run == NO_NODE) return false;
+            TrieNode* dst = &at(run);
+            for (uint32_t k = 0, from = 0; k < count; k++, from++) {
+                if (from == rank) from++;
+                copyNode(dst[k], old.first[from], count);
+            }
+        }
+        parent.firstChild.store(run, memory_order_release);
+        retire(old);
+        liveNodes.fetch_sub(1, memory_order_relaxed);
+        return true;
     }
-};
 
-// ===================================================================
-// GRAPH - Adjacency List with Dijkstra's, BFS, DFS
-// Time Complexity: Dijkstra's O((V+E)log V), BFS/DFS O(V+E)
-// ===================================================================
+    static void copyNode(TrieNode &d, const TrieNode &s, uint32_t runLength) {
+        d.firstChild.store(s.firstChild.load(memory_order_relaxed), memory_order_relaxed);
+        d.word.store(s.word.load(memory_order_relaxed), memory_order_relaxed);
+        d.score.store(s.score.load(memory_order_relaxed), memory_order_relaxed);
+        d.maxScore.store(s.maxScore.load(memory_order_relaxed), memory_order_relaxed);
+        d.payload.store(s.payload.load(memory_order_relaxed), memory_order_relaxed);
+        d.label = s.label;
+        d.runLength = runLength;
+        d.version.store(0, memory_order_relaxed);
+    }
 
-class Graph {
-private:
-    unordered_map<string, int> nameToNode;
-    vector<string> nodeToName;
-    vector<vector<pair<int, int>>> adj;
+    // Rewrites the word ending at n under its seqlock, so matchOf() never
+    // pairs one insert's spelling with another's payload or score
+    static void setWord(TrieNode &n, Symbol word, uint32_t score, uint32_t payload) {
+        uint8_t v = n.version.load(memory_order_relaxed);
+        n.version.store(v + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        n.score.store(score, memory_order_relaxed);
+        n.payload.store(payload, memory_order_relaxed);
+        n.word.store(word, memory_order_release);
+        n.version.store(v + 2, memory_order_release);
+    }
 
-    void DFSHelper(int u, vector<bool> &visited, vector<string> &result) {
-        visited[u] = true;
-        result.push_back(nodeToName[u]);
-        
-        for (auto &edge : adj[u]) {
-            int v = edge.first;
-            if (!visited[v]) {
-                DFSHelper(v, visited, result);
-            }
+    void retire(const Run &old) {
+        if (old.count > 0) {
+            retired[epoch.load(memory_order_relaxed) & 1].push_back({old.index, old.count});
         }
     }
 
-public:
-    Graph() {}
-
-    int addLocation(string name) {
-        string normalized = toLower(name);
-        
-        for (auto& pair : nameToNode) {
-            if (toLower(pair.first) == normalized) {
-                return pair.second;
+    // Recomputes subtree maxima bottom-up along `path` (root first), after
+    // a score on it was lowered or removed
+    void refreshMaxScores() {
+        for (size_t k = path.size(); k-- > 0;) {
+            TrieNode &n = at(path[k]);
+            uint32_t best = n.isEnd() ? n.score.load(memory_order_relaxed) : 0;
+            Run run = children(n);
+            for (uint32_t c = 0; c < run.count; c++) {
+                best = max(best, run.first[c].maxScore.load(memory_order_relaxed));
             }
+            n.maxScore.store(best, memory_order_relaxed);
         }
-        
-        int id = nodeToName.size();
-        nameToNode[name] = id;
-        nodeToName.push_back(name);
-        adj.push_back({});
-        
-        return id;
     }
 
-    void addEdge(string uName, string vName, int w) {
-        int u = addLocation(uName);
-        int v = addLocation(vName);
-        
-        for (auto& edge : adj[u]) {
-            if (edge.first == v) {
-                edge.second = w;
-                for (auto& revEdge : adj[v]) {
-                    if (revEdge.first == u) {
-                        revEdge.second = w;
-                        break;
-                    }
-                }
-                return;
-            }
+    // Frees the runs retired in the previous epoch once its readers have
+    // all left, then starts a new epoch. Never waits: with readers still
+    // inside, the runs stay retired until a later insert.
+    void reclaim() {
+        uint64_t e = epoch.load(memory_order_relaxed);
+        int previous = (e + 1) & 1;
+        if (readers[previous].load() != 0) return;
+        for (auto &r : retired[previous]) {
+            freeRuns[r.second].push_back(r.first);
         }
-        
-        adj[u].push_back({v, w});
-        adj[v].push_back({u, w});
+        retired[previous].clear();
+        epoch.store(e + 1);
     }
 
-    bool hasLocation(string name) {
-        string normalized = toLower(name);
-        for (auto& pair : nameToNode) {
-            if (toLower(pair.first) == normalized) {
-                return true;
+    // Depth-first preorder below start in key byte order. visit(node,
+    // depth) sees every node under start; depth counts key bytes below
+    // start. The current level lives in locals; `walk` only holds the
+    // parked parent levels.
+    template <typename F>
+    void walkBelow(uint32_t start, vector<WalkFrame> &walk, F visit) const {
+        Run run = children(at(start));
+        const TrieNode* next = run.first;
+        uint32_t left = run.count;
+        size_t depth = 0;
+        for (;;) {
+            if (!left) {
+                if (depth == 0) break;
+                depth--;
+                next = walk[depth].next;
+                left = walk[depth].left;
+                continue;
+            }
+            const TrieNode &n = *next++;
+            left--;
+            Run below = children(n);
+            visit(n, depth + 1);
+            if (below.count) {
+                if (depth == walk.size()) walk.resize(max<size_t>(16, walk.size() * 2));
+                walk[depth++] = {next, left};
+                next = below.first;
+                left = below.count;
             }
         }
-        return false;
     }
 
-    string getActualLocationName(string name) {
-        string normalized = toLower(name);
-        for (auto& pair : nameToNode) {
-            if (toLower(pair.first) == normalized) {
-                return pair.first;
+    // q.key holds the key bytes that reach start
+    void collectAll(uint32_t start, QueryState &q, SuggestionBuffer &out) const {
+        string &key = q.key;
+        size_t base = key.size();
+        if (at(start).isEnd()) {
+            out.add(key);
+        }
+        walkBelow(start, q.walk, [&](const TrieNode &n, size_t depth) {
+            key.resize(base + depth - 1);
+            key.push_back((char)n.label);
+            if (n.isEnd()) {
+                out.add(key);
             }
+        });
+    }
+
+    void collectSymbols(uint32_t start, QueryState &q, vector<Symbol> &out) const {
+        Symbol w = at(start).wordSymbol();
+        if (w != NO_SYMBOL) {
+            out.push_back(w);
         }
-        return name;
+        walkBelow(start, q.walk, [&](const TrieNode &n, size_t) {
+            Symbol w = n.wordSymbol();
+            if (w != NO_SYMBOL) {
+                out.push_back(w);
+            }
+        });
     }
 
-    bool shortestPath(string srcName, string destName, vector<string> &pathOut, int &distOut) {
-        pathOut.clear();
-        distOut = INF;
-
-        srcName = getActualLocationName(srcName);
-        destName = getActualLocationName(destName);
+    // Folds prefix into key and returns the node it reaches, or NO_NODE
+    uint32_t findPrefix(const string &prefix, string &key) const {
+        key.clear();
+        appendFoldedKey(prefix, key);
+        uint32_t cur = ROOT;
+        for (char c : key) {
+            cur = child(cur, (uint8_t)c);
+            if (cur == NO_NODE) {
+                return NO_NODE;
+            }
+        }
+        return cur;
+    }
 
-        if (!hasLocation(srcName) || !hasLocation(destName)) {
-            return false;
+    // Pops the k best candidates off the seeded frontier, expanding
+    // subtrees into their word and children at the same edit rank.
+    // emit(node, word) is called for each of the k words, best first, with
+    // the word symbol loaded once: a concurrent remove() can clear it after
+    // the candidate was pushed, and such a candidate is skipped. emit
+    // returns false to skip one too (a removal it saw on a later read).
+    template <typename F>
+    void drainFrontier(size_t k, vector<Candidate> &frontier, F emit) const {
+        size_t emitted = 0;
+        while (!frontier.empty() && emitted < k) {
+            pop_heap(frontier.begin(), frontier.end());
+            Candidate top = frontier.back();
+            frontier.pop_back();
+            const TrieNode &n = at(top.node);
+            if (top.isWord) {
+                Symbol w = n.wordSymbol();
+                if (w != NO_SYMBOL && emit(n, w)) {
+                    emitted++;
+                }
+                continue;
+            }
+            uint64_t rank = top.key >> 32 << 32;
+            if (n.isEnd()) {
+                frontier.push_back({rank | n.score.load(memory_order_relaxed), top.node, true});
+                push_heap(frontier.begin(), frontier.end());
+            }
+            Run run = children(n);
+            for (uint32_t k = 0; k < run.count; k++) {
+                frontier.push_back({rank | run.first[k].maxScore.load(memory_order_relaxed), run.index + k, false});
+                push_heap(frontier.begin(), frontier.end());
+            }
         }
+    }
 
-        int n = nodeToName.size();
-        vector<int> dist(n, INF);
-        vector<int> parent(n, -1);
-        vector<bool> visited(n, false);
+    static void addFuzzyCandidate(QueryState &q, uint32_t node, uint8_t edits, uint32_t score, bool isWord) {
+        uint64_t rank = (uint64_t)(q.editCap - edits) << 32;
+        q.frontier.push_back({rank | score, node, isWord});
+    }
 
-        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+    // Walks the trie in lockstep with the query's Levenshtein automaton.
+    // `row` is the distance row after the last complete key character and
+    // `best` the fewest edits from the query to any key prefix on the path.
+    // Row minima never decrease going down, so once the row minimum reaches
+    // best no descendant can do better: the subtree becomes one candidate
+    // at best edits (or is pruned if best is over the bound). Recursion is
+    // bounded by (query length + max edits + 1) characters.
+    void fuzzyWalk(QueryState &q, uint32_t node, size_t row, Utf8Decoder dec, uint8_t best) const {
+        size_t width = q.query.size() + 1;
+        const uint8_t* cur = &q.rows[row * width];
+        best = min(best, cur[width - 1]);
+        uint8_t low = *min_element(cur, cur + width);
+        const TrieNode &n = at(node);
+        if (low >= best) {
+            if (best < q.editCap) {
+                addFuzzyCandidate(q, node, best, n.maxScore.load(memory_order_relaxed), false);
+            }
+            return;
+        }
+        if (n.isEnd() && best < q.editCap) {
+            addFuzzyCandidate(q, node, best, n.score.load(memory_order_relaxed), true);
+        }
+        Run run = children(n);
+        for (uint32_t k = 0; k < run.count; k++) {
+            Utf8Decoder next = dec;
+            if (!next.feed(run.first[k].label)) {
+                fuzzyWalk(q, run.index + k, row, next, best);
+                continue;
+            }
+            // Standard edit-distance recurrence for one more key character
+            const uint8_t* prev = &q.rows[row * width];
+            uint8_t* out = &q.rows[(row + 1) * width];
+            out[0] = min<int>(q.editCap, prev[0] + 1);
+            for (size_t j = 1; j < width; j++) {
+                int d = prev[j - 1] + (q.query[j - 1] != next.cp);
+                d = min(d, prev[j] + 1);
+                d = min(d, out[j - 1] + 1);
+                out[j] = min<int>(q.editCap, d);
+            }
+            fuzzyWalk(q, run.index + k, row + 1, next, best);
+        }
+    }
 
-        int s = nameToNode[srcName];
-        int t = nameToNode[destName];
+    // Seqlock read of the word at n with its payload and score. The 8-bit
+    // version could only alias after 128 rewrites of this one node within
+    // a few loads. The word is NO_SYMBOL if it was removed meanwhile.
+    static TrieMatch matchOf(const TrieNode &n) {
+        for (;;) {
+            uint8_t before = n.version.load(memory_order_acquire);
+            if (before & 1) {
+                this_thread::yield();
+                continue;
+            }
+            TrieMatch m{n.wordSymbol(), n.payload.load(memory_order_relaxed), n.score.load(memory_order_relaxed)};
+            atomic_thread_fence(memory_order_acquire);
+            if (n.version.load(memory_order_relaxed) == before) {
+                return m;
+            }
+        }
+    }
 
-        dist[s] = 0;
-        pq.push({0, s});
+    static bool addMatch(const TrieNode &n, vector<TrieMatch> &out) {
+        TrieMatch m = matchOf(n);
+        if (m.word == NO_SYMBOL) {
+            return false;
+        }
+        out.push_back(m);
+        return true;
+    }
 
-        while (!pq.empty()) {
-            auto cur = pq.top();
-            pq.pop();
-            int u = cur.second;
+    template <typename F>
+    void topK(const string &prefix, size_t k, F emit) const {
+        ReadGuard guard(*this);
+        QueryState &q = queryState();
+        uint32_t start = findPrefix(prefix, q.key);
+        if (start == NO_NODE || k == 0) {
+            return;
+        }
+        q.frontier.clear();
+        q.frontier.push_back({at(start).maxScore.load(memory_order_relaxed), start, false});
+        drainFrontier(k, q.frontier, emit);
+    }
 
-            if (visited[u]) continue;
-            visited[u] = true;
+    template <typename F>
+    void fuzzyTopK(const string &prefix, int maxEdits, size_t k, F emit) const {
+        if (k == 0) {
+            return;
+        }
+        ReadGuard guard(*this);
+        QueryState &q = queryState();
+        q.key.clear();
+        appendFoldedKey(prefix, q.key);
+        q.query.clear();
+        Utf8Decoder dec;
+        for (char c : q.key) {
+            if (dec.feed((uint8_t)c)) q.query.push_back(dec.cp);
+        }
+        q.editCap = (uint8_t)(min(max(maxEdits, 0), 254) + 1);
+        size_t width = q.query.size() + 1;
+        q.rows.resize((q.query.size() + q.editCap + 1) * width);
+        for (size_t j = 0; j < width; j++) {
+            q.rows[j] = (uint8_t)min<size_t>(q.editCap, j);
+        }
+        q.frontier.clear();
+        fuzzyWalk(q, ROOT, 0, Utf8Decoder(), q.editCap);
+        make_heap(q.frontier.begin(), q.frontier.end());
+        drainFrontier(k, q.frontier, emit);
+    }
 
-            for (auto &edge : adj[u]) {
-                int v = edge.first;
-                int w = edge.second;
+public:
+    Trie(StringInterner &interner = sharedInterner())
+        : largePages(nullptr), pageCount(1), liveNodes(1), arenaEnd(1), names(&interner), epoch(0) {
+        for (size_t i = 0; i < SMALL_PAGES; i++) {
+            smallPages[i].store(nullptr, memory_order_relaxed);
+        }
+        smallPages[0].store(new TrieNode[FIRST_PAGE_SIZE], memory_order_relaxed);
+        at(ROOT).runLength = 1;
+        readers[0].store(0);
+        readers[1].store(0);
+    }
 
-                if (dist[u] + w < dist[v]) {
-                    dist[v] = dist[u] + w;
-                    parent[v] = u;
-                    pq.push({dist[v], v});
-                }
+    ~Trie() {
+        for (size_t i = 0; i < SMALL_PAGES; i++) {
+            delete[] smallPages[i].load(memory_order_relaxed);
+        }
+        if (atomic<TrieNode*>* table = largePages.load(memory_order_relaxed)) {
+            for (size_t i = 0; i < LARGE_PAGES; i++) {
+                delete[] table[i].load(memory_order_relaxed);
             }
+            delete[] table;
         }
+    }
 
-        if (dist[t] == INF) {
+    Trie(const Trie&) = delete;
+    Trie& operator=(const Trie&) = delete;
+
+    // Inserting a word again replaces its spelling, score and payload.
+    // Returns false if the node arena or the interner is full.
+    bool insert(const string &word, uint32_t score = 0, uint32_t payload = NO_PAYLOAD) {
+        Symbol spelling = names->intern(word);
+        if (spelling == NO_SYMBOL) {
             return false;
         }
+        lock_guard<mutex> lock(writeLock);
+        uint32_t cur = ROOT;
+        path.clear();
+        insertKey.clear();
+        appendFoldedKey(word, insertKey);
 
-        int cur = t;
-        while (cur != -1) {
-            if (!nodeToName[cur].empty()) {
-                pathOut.push_back(nodeToName[cur]);
+        for (char c : insertKey) {
+            path.push_back(cur);
+            uint32_t next = child(cur, (uint8_t)c);
+            cur = (next != NO_NODE) ? next : addChild(cur, (uint8_t)c);
+            if (cur == NO_NODE) {
+                reclaim();
+                return false;
             }
-            cur = parent[cur];
         }
 
-        reverse(pathOut.begin(), pathOut.end());
-        distOut = dist[t];
-        
+        TrieNode &end = at(cur);
+        bool lowered = end.isEnd() && score < end.score.load(memory_order_relaxed);
+        setWord(end, spelling, score, payload);
+        if (!lowered) {
+            path.push_back(cur);
+            for (uint32_t n : path) {
+                atomic<uint32_t> &best = at(n).maxScore;
+                if (best.load(memory_order_relaxed) < score) best.store(score, memory_order_relaxed);
+            }
+            reclaim();
+            return true;
+        }
+
+        // A lowered score may have been some ancestor's maximum: recompute
+        // bottom-up from the word and the children
+        path.push_back(cur);
+        refreshMaxScores();
+        reclaim();
         return true;
     }
 
-    vector<string> BFS(string startName) {
-        vector<string> result;
-        if (!hasLocation(startName)) {
-            return result;
+    // Removes word (matched by folded key). Nodes left with neither a word
+    // nor children are unlinked bottom-up and their runs go back on the
+    // free lists once no reader can reach them. Returns false if the word
+    // was not present.
+    bool remove(const string &word) {
+        lock_guard<mutex> lock(writeLock);
+        uint32_t cur = ROOT;
+        path.clear();
+        insertKey.clear();
+        appendFoldedKey(word, insertKey);
+        for (char c : insertKey) {
+            path.push_back(cur);
+            cur = child(cur, (uint8_t)c);
+            if (cur == NO_NODE) {
+                return false;
+            }
         }
+        TrieNode &end = at(cur);
+        if (!end.isEnd()) {
+            return false;
+        }
+        setWord(end, NO_SYMBOL, 0, NO_PAYLOAD);
 
-        startName = getActualLocationName(startName);
-        int start = nameToNode[startName];
-        int n = nodeToName.size();
-        
-        vector<bool> visited(n, false);
-        queue<int> q;
-        
-        visited[start] = true;
-        q.push(start);
-        
-        while (!q.empty()) {
-            int u = q.front();
-            q.pop();
-            result.push_back(nodeToName[u]);
-            
-            for (auto &edge : adj[u]) {
-                int v = edge.first;
-                if (!visited[v]) {
-                    visited[v] = true;
-                    q.push(v);
-                }
-            }
+        while (!path.empty() && !at(cur).isEnd() && children(at(cur)).count == 0) {
+            uint32_t parent = path.back();
+            if (!removeChild(parent, cur - children(at(parent)).index)) break;
+            path.pop_back();
+            cur = parent;
         }
-        
-        return result;
+        path.push_back(cur);
+        refreshMaxScores();
+        reclaim();
+        return true;
     }
 
-    vector<string> DFS(string startName) {
-        vector<string> result;
-        if (!hasLocation(startName)) {
-            return result;
+    // Folded keys under prefix in key byte order (alphabetical for ASCII),
+    // written into out (cleared first). No allocation once out and this
+    // thread's walk stack have grown to the largest result seen.
+    void suggest(const string &prefix, SuggestionBuffer &out) const {
+        ReadGuard guard(*this);
+        QueryState &q = queryState();
+        out.clear();
+        uint32_t cur = findPrefix(prefix, q.key);
+        if (cur != NO_NODE) {
+            collectAll(cur, q, out);
         }
+    }
 
-        startName = getActualLocationName(startName);
-        int start = nameToNode[startName];
-        int n = nodeToName.size();
-        
-        vector<bool> visited(n, false);
-        DFSHelper(start, visited, result);
-        
-        return result;
+    vector<string> suggest(const string &prefix) const {
+        SuggestionBuffer buf;
+        suggest(prefix, buf);
+        vector<string> out;
+        out.reserve(buf.size());
+        for (size_t i = 0; i < buf.size(); i++) {
+            out.push_back(string(buf[i]));
+        }
+        return out;
     }
 
-    bool isConnected() {
-        if (nodeToName.empty()) return true;
-        
-        int n = nodeToName.size();
-        vector<bool> visited(n, false);
-        queue<int> q;
-        
-        visited[0] = true;
-        q.push(0);
-        
-        while (!q.empty()) {
-            int u = q.front();
-            q.pop();
-            
-            for (auto &edge : adj[u]) {
-                int v = edge.first;
-                if (!visited[v]) {
-                    visited[v] = true;
-                    q.push(v);
-                }
-            }
+    // Same matches as suggest(), returned as symbols of the inserted spellings
+    vector<Symbol> suggestSymbols(const string &prefix) const {
+        ReadGuard guard(*this);
+        QueryState &q = queryState();
+        vector<Symbol> out;
+        uint32_t cur = findPrefix(prefix, q.key);
+        if (cur != NO_NODE) {
+            collectSymbols(cur, q, out);
         }
-        
-        for (bool v : visited) {
-            if (!v) return false;
+        return out;
+    }
+
+    // The k highest-scoring words under prefix, best first (inserted
+    // spellings). Best-first over subtree maxima, so only the nodes on the
+    // way to those k words and their siblings are touched.
+    vector<Symbol> suggestTopSymbols(const string &prefix, size_t k) const {
+        vector<Symbol> out;
+        topK(prefix, k, [&](const TrieNode &, Symbol w) {
+            out.push_back(w);
+            return true;
+        });
+        return out;
+    }
+
+    // Same ranking as suggestTopSymbols(), with each word's payload and
+    // score, so the caller needs no lookup by name afterwards
+    vector<TrieMatch> suggestTopMatches(const string &prefix, size_t k) const {
+        vector<TrieMatch> out;
+        topK(prefix, k, [&](const TrieNode &n, Symbol) { return addMatch(n, out); });
+        return out;
+    }
+
+    vector<string> suggest(const string &prefix, size_t k) const {
+        vector<string> out;
+        for (Symbol sym : suggestTopSymbols(prefix, k)) {
+            out.push_back(string(names->view(sym)));
         }
-        return true;
+        return out;
     }
 
-    int getNodeCount() { return nodeToName.size(); }
-    int getEdgeCount() {
-        int count = 0;
-        for (auto& edges : adj) {
-            count += edges.size();
+    // Typo-tolerant top-k: words that some key prefix of is within maxEdits
+    // character insertions, deletions or substitutions of the folded
+    // query, fewest edits first and then by score. The automaton walk only
+    // visits nodes whose distance row can still reach the bound, then the
+    // matching subtrees are ranked best-first like suggestTopSymbols().
+    vector<Symbol> suggestFuzzySymbols(const string &prefix, int maxEdits, size_t k) const {
+        vector<Symbol> out;
+        fuzzyTopK(prefix, maxEdits, k, [&](const TrieNode &, Symbol w) {
+            out.push_back(w);
+            return true;
+        });
+        return out;
+    }
+
+    vector<TrieMatch> suggestFuzzyMatches(const string &prefix, int maxEdits, size_t k) const {
+        vector<TrieMatch> out;
+        fuzzyTopK(prefix, maxEdits, k, [&](const TrieNode &n, Symbol) { return addMatch(n, out); });
+        return out;
+    }
+
+    vector<string> suggestFuzzy(const string &prefix, int maxEdits, size_t k) const {
+        vector<string> out;
+        for (Symbol sym : suggestFuzzySymbols(prefix, maxEdits, k)) {
+            out.push_back(string(names->view(sym)));
         }
-        return count / 2;
+        return out;
+    }
+
+    string_view nameOf(Symbol sym) const { return names->view(sym); }
+
+    size_t nodeCount() const { return liveNodes.load(memory_order_relaxed); }
+
+    // Arena pages and page table plus the free and retired run lists
+    size_t memoryBytes() const {
+        lock_guard<mutex> lock(writeLock);
+        size_t bytes = arenaCapacity(pageCount.load(memory_order_relaxed)) * sizeof(TrieNode);
+        if (largePages.load(memory_order_relaxed)) bytes += LARGE_PAGES * sizeof(atomic<TrieNode*>);
+        for (auto &runs : freeRuns) bytes += runs.capacity() * sizeof(uint32_t);
+        for (auto &runs : retired) bytes += runs.capacity() * sizeof(pair<uint32_t, uint32_t>);
+        return bytes;
     }
 };
 
 // ===================================================================
-// LINKED LIST - Bus Route Management
-// Time Complexity: O(n) for insert/delete/reverse
+// LOUDS TRIE - Immutable Succinct Trie for Read-Only Serving
+// A Trie frozen into one contiguous buffer: the shape as a level-order
+// unary degree sequence (each node's child count in unary, about 2 bits
+// per node) with sampled select, one label byte per node, a terminal bit
+// vector with a rank directory and the original spellings. The buffer is
+// position-independent, so a saved file is memory-mapped and served with
+// no parsing beyond a header check.
+// Time Complexity: O(m log f) prefix descent, O(1) select per node visited
 // ===================================================================
 
-struct Stop {
-    string name;
-    Stop* next;
-    
-    Stop(string n) : name(n), next(nullptr) {}
-};
+class LoudsTrie {
+private:
+    static constexpr uint64_t SELECT_SAMPLE = 256;  // zeros between select samples
+    static constexpr uint64_t RANK_BLOCK = 8;       // words per rank directory entry
 
-class BusRoute {
-public:
-    string routeName;
-    Stop* head;
+    // All sections start 8-byte aligned; offsets are from the buffer start
+    struct Header {
+        char magic[8];
+        uint64_t nodes;
+        uint64_t terminals;
+        uint64_t loudsWords;
+        uint64_t sampleCount;
+        uint64_t termWords;
+        uint64_t rankCount;
+        uint64_t namesBytes;
+        uint64_t loudsOff, sampleOff, labelsOff, termOff, rankOff, nameOffsOff, namesOff;
+        uint64_t totalBytes;
+    };
 
-    BusRoute() : head(nullptr) {}
-    BusRoute(string rn) : routeName(rn), head(nullptr) {}
+    const char* base;
+    const Header* header;
+    const uint64_t* louds;      // per node in level order: 1 per child, then 0
+    const uint32_t* samples;    // position of every SELECT_SAMPLE-th zero
+    const uint8_t* labels;      // key byte into each node (level order)
+    const uint64_t* terminal;   // bit per node: a word ends here
+    const uint32_t* termRank;   // terminal bits before each RANK_BLOCK words
+    const uint32_t* nameOffs;   // per terminal, start of its spelling; one extra at the end
+    const char* nameBytes;
 
-    ~BusRoute() {
-        while (head) {
-            Stop* tmp = head;
-            head = head->next;
-            delete tmp;
-        }
-    }
+    void* mapped;
+    size_t mappedSize;
 
-    void addStop(string n) {
-        Stop* node = new Stop(n);
-        
-        if (!head) {
-            head = node;
-            return;
-        }
+    static const char* magicTag() { return "NXLOUDS1"; }
 
-        Stop* cur = head;
-        while (cur->next) {
-            cur = cur->next;
+    // Position of the k-th zero (0-based) in the degree sequence
+    uint64_t select0(uint64_t k) const {
+        uint64_t pos = samples[k / SELECT_SAMPLE];
+        uint64_t skip = k % SELECT_SAMPLE;
+        uint64_t w = pos / 64;
+        uint64_t word = ~louds[w] & (~0ULL << (pos % 64));
+        for (;;) {
+            uint64_t zeros = __builtin_popcountll(word);
+            if (skip < zeros) {
+                for (; skip; skip--) word &= word - 1;
+                return w * 64 + __builtin_ctzll(word);
+            }
+            skip -= zeros;
+            word = ~louds[++w];
         }
-        cur->next = node;
     }
 
-    bool deleteStop(string n) {
-        if (!head) return false;
-        
-        if (head->name == n) {
-            Stop* tmp = head;
-            head = head->next;
-            delete tmp;
-            return true;
-        }
+    // Level-order id of node's first child and its child count
+    void children(uint64_t node, uint64_t &first, uint64_t &count) const {
+        uint64_t start = node ? select0(node - 1) + 1 : 0;
+        uint64_t end = select0(node);
+        first = start - node + 1;  // ones before start, plus the root
+        count = end - start;
+    }
 
-        Stop* cur = head;
-        while (cur->next && cur->next->name != n) {
-            cur = cur->next;
-        }
+    bool isEnd(uint64_t node) const {
+        return (terminal[node / 64] >> (node % 64)) & 1;
+    }
 
-        if (!cur->next) return false;
+    // Index of node among the terminals, for its spelling
+    uint64_t terminalIndex(uint64_t node) const {
+        uint64_t w = node / 64;
+        uint64_t rank = termRank[w / RANK_BLOCK];
+        for (uint64_t i = w - w % RANK_BLOCK; i < w; i++) rank += __builtin_popcountll(terminal[i]);
+        return rank + __builtin_popcountll(terminal[w] & ((1ULL << (node % 64)) - 1));
+    }
 
-        Stop* tmp = cur->next;
-        cur->next = tmp->next;
-        delete tmp;
+    // Node reached by the folded key, or false
+    bool descend(const string &key, uint64_t &node) const {
+        node = 0;
+        for (char c : key) {
+            uint64_t first, count;
+            children(node, first, count);
+            const uint8_t* lo = labels + first;
+            const uint8_t* it = lower_bound(lo, lo + count, (uint8_t)c);
+            if (it == lo + count || *it != (uint8_t)c) return false;
+            node = it - labels;
+        }
         return true;
     }
 
-    void reverseRoute() {
-        Stop* prev = nullptr;
-        Stop* cur = head;
+    // Length of the run of ones starting at pos: a node's child count
+    uint64_t onesAt(uint64_t pos) const {
+        uint64_t n = 0;
+        for (;;) {
+            uint64_t word = louds[pos / 64] >> (pos % 64);
+            uint64_t avail = 64 - pos % 64;
+            uint64_t run = ~word ? min<uint64_t>(__builtin_ctzll(~word), avail) : avail;
+            n += run;
+            if (run < avail) return n;
+            pos += run;
+        }
+    }
 
-        while (cur) {
-            Stop* nxt = cur->next;
-            cur->next = prev;
-            prev = cur;
-            cur = nxt;
+    // Preorder walk below start in key byte order; visit(node, depth).
+    // Siblings' degree descriptors are consecutive in the bit vector, and
+    // so are the child runs of consecutive siblings, so a cursor per level
+    // replaces per-node select: one select0 per sibling run descended into.
+    template <typename F>
+    void walkBelow(uint64_t start, F visit) const {
+        const uint64_t NO_POS = numeric_limits<uint64_t>::max();
+        struct Frame {
+            uint64_t next;     // next sibling to visit
+            uint64_t left;     // siblings left, including next
+            uint64_t pos;      // bit position of next's degree descriptor
+            uint64_t childPos; // descriptor of the next child run, if known
+        };
+        vector<Frame> parked;
+        uint64_t first, count;
+        children(start, first, count);
+        if (!count) return;
+        Frame f = {first, count, select0(first - 1) + 1, NO_POS};
+        for (;;) {
+            if (!f.left) {
+                if (parked.empty()) break;
+                uint64_t after = f.pos;  // where the parent's next child run starts
+                f = parked.back();
+                parked.pop_back();
+                f.childPos = after;
+                continue;
+            }
+            uint64_t node = f.next++;
+            f.left--;
+            uint64_t degree = onesAt(f.pos);
+            uint64_t childFirst = f.pos - node + 1;
+            f.pos += degree + 1;
+            visit(node, parked.size() + 1);
+            if (degree) {
+                uint64_t childPos = (f.childPos != NO_POS) ? f.childPos : select0(childFirst - 1) + 1;
+                parked.push_back(f);
+                f = {childFirst, degree, childPos, NO_POS};
+            }
         }
+    }
 
-        head = prev;
+    static void appendAligned(string &out, const void* data, size_t bytes) {
+        out.append((const char*)data, bytes);
+        out.append((8 - out.size() % 8) % 8, '\0');
     }
 
-    vector<string> getStopsVector() {
-        vector<string> v;
-        Stop* cur = head;
-        while (cur) {
-            v.push_back(cur->name);
-            cur = cur->next;
-        }
-        return v;
+public:
+    LoudsTrie() : base(nullptr), header(nullptr), mapped(nullptr), mappedSize(0) {}
+
+    ~LoudsTrie() {
+        if (mapped) ::munmap(mapped, mappedSize);
     }
 
-    int size() {
-        int count = 0;
-        Stop* cur = head;
-        while (cur) {
-            count++;
-            cur = cur->next;
+    LoudsTrie(const LoudsTrie&) = delete;
+    LoudsTrie& operator=(const LoudsTrie&) = delete;
+
+    // Freezes trie into the serialized form
+    static string build(const Trie &trie) {
+        // Level order over the arena; children are contiguous and sorted.
+        // Child counts are recorded in this one pass, so an insert running
+        // meanwhile cannot make the degree bits and the node order disagree.
+        Trie::ReadGuard guard(trie);
+        vector<uint32_t> order;
+        vector<uint32_t> childCounts;
+        order.reserve(trie.nodeCount());
+        order.push_back(Trie::ROOT);
+        for (size_t i = 0; i < order.size(); i++) {
+            Trie::Run run = trie.children(trie.at(order[i]));
+            childCounts.push_back(run.count);
+            for (uint32_t k = 0; k < run.count; k++) {
+                order.push_back(run.index + k);
+            }
         }
-        return count;
+
+        uint64_t n = order.size();
+        uint64_t bits = 2 * n - 1;
+        vector<uint64_t> loudsBits((bits + 63) / 64, 0);
+        vector<uint32_t> sampleVec;
+        vector<uint8_t> labelVec(n);
+        vector<uint64_t> termBits((n + 63) / 64, 0);
+        vector<uint32_t> offs;
+        string spellings;
+        uint64_t pos = 0, zeros = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            const TrieNode &node = trie.at(order[i]);
+            for (uint32_t c = 0; c < childCounts[i]; c++, pos++) {
+                loudsBits[pos / 64] |= 1ULL << (pos % 64);
+            }
+            if (zeros++ % SELECT_SAMPLE == 0) sampleVec.push_back(pos);
+            pos++;
+            labelVec[i] = node.label;
+            Symbol word = node.wordSymbol();
+            if (word != NO_SYMBOL) {
+                termBits[i / 64] |= 1ULL << (i % 64);
+                offs.push_back(spellings.size());
+                string_view name = trie.nameOf(word);
+                spellings.append(name.data(), name.size());
+            }
+        }
+        uint64_t terminals = offs.size();
+        offs.push_back(spellings.size());
+        vector<uint32_t> rankVec;
+        uint32_t ones = 0;
+        for (size_t w = 0; w < termBits.size(); w++) {
+            if (w % RANK_BLOCK == 0) rankVec.push_back(ones);
+            ones += __builtin_popcountll(termBits[w]);
+        }
+
+        Header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, magicTag(), 8);
+        h.nodes = n;
+        h.terminals = terminals;
+        h.loudsWords = loudsBits.size();
+        h.sampleCount = sampleVec.size();
+        h.termWords = termBits.size();
+        h.rankCount = rankVec.size();
+        h.namesBytes = spellings.size();
+
+        string out(sizeof(Header), '\0');
+        h.loudsOff = out.size();
+        appendAligned(out, loudsBits.data(), loudsBits.size() * 8);
+        h.sampleOff = out.size();
+        appendAligned(out, sampleVec.data(), sampleVec.size() * 4);
+        h.labelsOff = out.size();
+        appendAligned(out, labelVec.data(), labelVec.size());
+        h.termOff = out.size();
+        appendAligned(out, termBits.data(), termBits.size() * 8);
+        h.rankOff = out.size();
+        appendAligned(out, rankVec.data(), rankVec.size() * 4);
+        h.nameOffsOff = out.size();
+        appendAligned(out, offs.data(), offs.size() * 4);
+        h.namesOff = out.size();
+        appendAligned(out, spellings.data(), spellings.size());
+        h.totalBytes = out.size();
+        memcpy(&out[0], &h, sizeof(h));
+        return out;
     }
-};
 
-class BusRouteManager {
-private:
-    unordered_map<string, BusRoute> routes;
+    // Section of count elements of width bytes at off lies inside total
+    static bool sectionFits(uint64_t off, uint64_t count, uint64_t width, uint64_t total) {
+        return off % 8 == 0 && off >= sizeof(Header) && off <= total &&
+               count <= (total - off) / width;
+    }
 
-public:
-    bool addRoute(string rn) {
-        if (routes.find(rn) != routes.end()) {
+    // Header counts agree with each other and every section lies inside
+    // the buffer; O(1), the bit vectors themselves are trusted
+    static bool headerValid(const Header &h, size_t size) {
+        if (h.totalBytes > size || h.nodes == 0 || h.nodes > numeric_limits<uint32_t>::max() ||
+            h.terminals > h.nodes) {
             return false;
         }
-        routes[rn] = BusRoute(rn);
-        return true;
+        uint64_t termWords = (h.nodes + 63) / 64;
+        if (h.loudsWords != (2 * h.nodes - 1 + 63) / 64 ||
+            h.sampleCount != (h.nodes + SELECT_SAMPLE - 1) / SELECT_SAMPLE ||
+            h.termWords != termWords ||
+            h.rankCount != (termWords + RANK_BLOCK - 1) / RANK_BLOCK) {
+            return false;
+        }
+        uint64_t total = h.totalBytes;
+        return sectionFits(h.loudsOff, h.loudsWords, 8, total) &&
+               sectionFits(h.sampleOff, h.sampleCount, 4, total) &&
+               sectionFits(h.labelsOff, h.nodes, 1, total) &&
+               sectionFits(h.termOff, h.termWords, 8, total) &&
+               sectionFits(h.rankOff, h.rankCount, 4, total) &&
+               sectionFits(h.nameOffsOff, h.terminals + 1, 4, total) &&
+               sectionFits(h.namesOff, h.namesBytes, 1, total);
     }
 
-    bool addStopToRoute(string rn, string s) {
-        if (routes.find(rn) == routes.end()) {
+    // Serves directly from data, which must stay alive and be 8-byte
+    // aligned; the header and section bounds are checked, not the bits.
+    // On failure the previous contents stay attached.
+    bool attach(const char* data, size_t size) {
+        const Header* h = (const Header*)data;
+        if (size < sizeof(Header) || memcmp(h->magic, magicTag(), 8) != 0 || !headerValid(*h, size)) {
             return false;
         }
-        routes[rn].addStop(s);
+        const uint32_t* offs = (const uint32_t*)(data + h->nameOffsOff);
+        if (offs[h->terminals] > h->namesBytes) return false;
+        base = data;
+        header = h;
+        louds = (const uint64_t*)(base + h->loudsOff);
+        samples = (const uint32_t*)(base + h->sampleOff);
+        labels = (const uint8_t*)(base + h->labelsOff);
+        terminal = (const uint64_t*)(base + h->termOff);
+        termRank = (const uint32_t*)(base + h->rankOff);
+        nameOffs = (const uint32_t*)(base + h->nameOffsOff);
+        nameBytes = base + h->namesOff;
         return true;
     }
 
-    bool deleteStopFromRoute(string rn, string s) {
-        if (routes.find(rn) == routes.end()) {
-            return false;
+    static bool save(const Trie &trie, const string &path) {
+        string buf = build(trie);
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        const char* p = buf.data();
+        size_t left = buf.size();
+        while (left > 0) {
+            ssize_t w = ::write(fd, p, left);
+            if (w <= 0) break;
+            p += w;
+            left -= w;
         }
-        return routes[rn].deleteStop(s);
+        ::close(fd);
+        return left == 0;
     }
 
-    bool deleteRoute(string rn) {
-        if (routes.find(rn) == routes.end()) {
+    // Maps a saved file read-only; pages load on first touch
+    bool open(const string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        if (!attach((const char*)p, st.st_size)) {
+            ::munmap(p, st.st_size);
             return false;
         }
-        routes.erase(rn);
+        if (mapped) ::munmap(mapped, mappedSize);
+        mapped = p;
+        mappedSize = st.st_size;
         return true;
     }
 
-    bool reverseRoute(string rn) {
-        if (routes.find(rn) == routes.end()) {
-            return false;
-        }
-        routes[rn].reverseRoute();
-        return true;
+    // Same keys, in the same order, as Trie::suggest
+    void suggest(const string &prefix, SuggestionBuffer &out) const {
+        out.clear();
+        if (!header) return;
+        string key;
+        appendFoldedKey(prefix, key);
+        uint64_t start;
+        if (!descend(key, start)) return;
+        size_t base = key.size();
+        if (isEnd(start)) out.add(key);
+        walkBelow(start, [&](uint64_t node, size_t depth) {
+            key.resize(base + depth - 1);
+            key.push_back((char)labels[node]);
+            if (isEnd(node)) out.add(key);
+        });
     }
 
-    vector<string> getAllRouteNames() {
-        vector<string> names;
-        for (auto& pair : routes) {
-            names.push_back(pair.first);
-        }
-        return names;
+    vector<string> suggest(const string &prefix) const {
+        SuggestionBuffer buf;
+        suggest(prefix, buf);
+        vector<string> out;
+        for (size_t i = 0; i < buf.size(); i++) out.push_back(string(buf[i]));
+        return out;
     }
 
-    vector<string> getRouteStops(string rn) {
-        if (routes.find(rn) == routes.end()) {
-            return {};
-        }
-        return routes[rn].getStopsVector();
+    // Inserted spellings of the same matches, as views into the buffer
+    vector<string_view> suggestSpellings(const string &prefix) const {
+        vector<string_view> out;
+        if (!header) return out;
+        string key;
+        appendFoldedKey(prefix, key);
+        uint64_t start;
+        if (!descend(key, start)) return out;
+        auto emit = [&](uint64_t node) {
+            uint64_t t = terminalIndex(node);
+            out.push_back(string_view(nameBytes + nameOffs[t], nameOffs[t + 1] - nameOffs[t]));
+        };
+        if (isEnd(start)) emit(start);
+        walkBelow(start, [&](uint64_t node, size_t) {
+            if (isEnd(node)) emit(node);
+        });
+        return out;
+    }
+
+    size_t nodeCount() const { return header ? header->nodes : 0; }
+    size_t wordCount() const { return header ? header->terminals : 0; }
+    size_t sizeBytes() const { return header ? header->totalBytes : 0; }
+    // Of sizeBytes(), the original spellings and their offsets
+    size_t spellingBytes() const {
+        return header ? header->namesBytes + (header->terminals + 1) * sizeof(uint32_t) : 0;
     }
 };
 
 // ===================================================================
-// QUEUE - FIFO Data Structure for Traffic Updates
-// Time Complexity: O(1) for enqueue/dequeue
+// INFIX INDEX - Trigram Inverted Index for Substring Search
+// Every 3-byte window of a name's folded key lists the names containing
+// it. Names are numbered in insertion order, so each posting list is
+// sorted as it grows and is stored as varint gaps, with a skip entry
+// every 64 postings. A query intersects the lists of its trigrams rarest
+// first, seeking through the others by skip entry, and checks each
+// surviving key for the whole substring. Queries of one or two bytes are
+// answered from the best 64 names kept per such gram as names are added.
+// Time Complexity: O(m) add for m key bytes; a query decodes about the
+// rarest list plus one skip block per seek into the others; a one- or
+// two-byte query costs O(k log k)
 // ===================================================================
 
-enum TrafficLevel { LOW=1, MEDIUM=2, HIGH=3 };
-
-struct TrafficUpdate {
-    string routeName;
-    TrafficLevel level;
-    
-    TrafficUpdate(string r="", TrafficLevel l=LOW) : routeName(r), level(l) {}
-};
-
-class TrafficManager {
+class InfixIndex {
 private:
-    queue<TrafficUpdate> updates;
-    unordered_map<string, TrafficLevel> currentTraffic;
+    static constexpr uint32_t SKIP_EVERY = 64;
+    static constexpr uint32_t SHORT_TOP = 64;
 
-public:
-    void pushUpdate(TrafficUpdate u) {
-        updates.push(u);
-    }
+    // Entry ids ascending, as varint gaps from the previous id
+    struct PostingList {
+        vector<uint8_t> bytes;
+        // (id, offset just past it) of every SKIP_EVERY-th posting
+        vector<pair<uint32_t, uint32_t>> skips;
+        uint32_t last = 0;
+        uint32_t count = 0;
 
-    int processUpdates() {
-        int count = 0;
-        while (!updates.empty()) {
-            TrafficUpdate u = updates.front();
-            updates.pop();
-            currentTraffic[u.routeName] = u.level;
-            count++;
+        void push(uint32_t id) {
+            uint32_t gap = count ? id - last : id;
+            while (gap >= 0x80) {
+                bytes.push_back((uint8_t)(gap | 0x80));
+                gap >>= 7;
+            }
+            bytes.push_back((uint8_t)gap);
+            last = id;
+            if (++count % SKIP_EVERY == 0) {
+                skips.push_back({id, (uint32_t)bytes.size()});
+            }
         }
-        return count;
-    }
+    };
 
-    int queueSize() { return updates.size(); }
-    bool isEmpty() { return updates.empty(); }
-};
+    // Forward-only decoder over one posting list
+    struct Cursor {
+        const PostingList* list;
+        uint32_t pos = 0;    // offset of the next gap
+        uint32_t read = 0;   // postings decoded so far
+        uint32_t id = 0;     // the last one
 
-// ===================================================================
-// AVL TREE - Self-Balancing Binary Search Tree
-// Time Complexity: O(log n) for all operations
+        bool next() {
+            if (pos == list->bytes.size()) return false;
+            uint32_t gap = 0;
+            int shift = 0;
+            uint8_t byte;
+            do {
+                byte = list->bytes[pos++];
+                gap |= (uint32_t)(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            id = read++ ? id + gap : gap;
+            return true;
+        }
+
+        // Moves to the first posting >= target, jumping whole skip blocks
+        // that end below it; false once the list runs out
+        bool seek(uint32_t target) {
+            if (read > 0 && id >= target) return true;
+            const auto &skips = list->skips;
+            size_t block = lower_bound(skips.begin(), skips.end(), make_pair(target, 0u)) - skips.begin();
+            if (block > 0 && block * SKIP_EVERY > read) {
+                id = skips[block - 1].first;
+                pos = skips[block - 1].second;
+                read = block * SKIP_EVERY;
+            }
+            while (read == 0 || id < target) {
+                if (!next()) return false;
+            }
+            return true;
+        }
+    };
+
+    struct Entry {
+        Symbol word;
+        uint32_t payload;
+        uint32_t score;
+        uint32_t keyOffset;
+        uint32_t keyLength;
+    };
+
+    // A verified match; higher rank is better
+    struct Hit {
+        uint64_t rank;  // score, then earlier match position
+        uint32_t entry;
+        bool operator>(const Hit &o) const {
+            return rank != o.rank ? rank > o.rank : entry < o.entry;
+        }
+    };
+
+    // Query scratch, one per thread: the folded query, its distinct
+    // trigrams' cursors and the k best hits as a min-heap
+    struct QueryState {
+        string key;
+        vector<uint32_t> grams;
+        vector<Cursor> cursors;
+        vector<Hit> best;
+    };
+
+    static QueryState& queryState() {
+        static thread_local QueryState state;
+        return state;
+    }
+
+    vector<Entry> entries;
+    string keys;  // folded keys back to back
+    unordered_map<uint32_t, PostingList> postings;
+    // The SHORT_TOP best hits for every 1- and 2-byte gram, as min-heaps.
+    // A query that short is the gram itself, so each name's rank for it
+    // is known when the name is added.
+    unordered_map<uint32_t, vector<Hit>> shortBest;
+    StringInterner* names;
+
+    static uint32_t gramAt(string_view key, size_t i) {
+        return (uint32_t)(uint8_t)key[i] << 16 | (uint32_t)(uint8_t)key[i + 1] << 8 | (uint8_t)key[i + 2];
+    }
+
+    // Keyed apart from trigrams and from each other by the length bit
+    static uint32_t shortGramAt(string_view key, size_t i, size_t len) {
+        return len == 1 ? (uint8_t)key[i] : 1u << 16 | (uint32_t)(uint8_t)key[i] << 8 | (uint8_t)key[i + 1];
+    }
+
+    // Keeps the k best hits in a min-heap
+    static void keepBest(vector<Hit> &best, const Hit &hit, size_t k) {
+        if (best.size() < k) {
+            best.push_back(hit);
+            push_heap(best.begin(), best.end(), greater<Hit>());
+        } else if (hit > best.front()) {
+            pop_heap(best.begin(), best.end(), greater<Hit>());
+            best.back() = hit;
+            push_heap(best.begin(), best.end(), greater<Hit>());
+        }
+    }
+
+    string_view keyOf(const Entry &e) const {
+        return string_view(keys).substr(e.keyOffset, e.keyLength);
+    }
+
+    // Ranks entry if its key contains the query, keeping the k best
+    void consider(QueryState &q, uint32_t id, size_t k) const {
+        const Entry &e = entries[id];
+        size_t at = keyOf(e).find(q.key);
+        if (at == string_view::npos) return;
+        keepBest(q.best, Hit{(uint64_t)e.score << 32 | (uint32_t)~at, id}, k);
+    }
+
+    // emit(entry) for the k best matches, best first
+    template <typename F>
+    void topK(const string &query, size_t k, F emit) const {
+        QueryState &q = queryState();
+        q.key.clear();
+        appendFoldedKey(query, q.key);
+        q.best.clear();
+        if (k == 0 || q.key.empty()) return;
+
+        if (q.key.size() < 3 && k <= SHORT_TOP) {
+            // Shorter than a trigram: the gram's best hits are the answer
+            auto it = shortBest.find(shortGramAt(q.key, 0, q.key.size()));
+            if (it == shortBest.end()) return;
+            q.best.assign(it->second.begin(), it->second.end());
+            while (q.best.size() > k) {
+                pop_heap(q.best.begin(), q.best.end(), greater<Hit>());
+                q.best.pop_back();
+            }
+        } else if (q.key.size() < 3) {
+            // Deeper than the kept hits: every key is a candidate
+            for (uint32_t id = 0; id < entries.size(); id++) consider(q, id, k);
+        } else {
+            q.grams.clear();
+            for (size_t i = 0; i + 3 <= q.key.size(); i++) q.grams.push_back(gramAt(q.key, i));
+            sort(q.grams.begin(), q.grams.end());
+            q.grams.erase(unique(q.grams.begin(), q.grams.end()), q.grams.end());
+            q.cursors.clear();
+            for (uint32_t gram : q.grams) {
+                auto it = postings.find(gram);
+                if (it == postings.end()) return;
+                q.cursors.push_back(Cursor{&it->second});
+            }
+            sort(q.cursors.begin(), q.cursors.end(),
+                 [](const Cursor &a, const Cursor &b) { return a.list->count < b.list->count; });
+
+            // The rarest list proposes, the others seek to the proposal
+            // and raise it until they all agree
+            uint32_t target = 0;
+            for (bool more = true; more;) {
+                bool agreed = true;
+                for (Cursor &c : q.cursors) {
+                    if (!c.seek(target)) {
+                        more = false;
+                        break;
+                    }
+                    if (c.id > target) {
+                        target = c.id;
+                        agreed = false;
+                        break;
+                    }
+                }
+                if (more && agreed) {
+                    consider(q, target, k);
+                    more = ++target != 0;
+                }
+            }
+        }
+        sort_heap(q.best.begin(), q.best.end(), greater<Hit>());
+        for (const Hit &h : q.best) emit(entries[h.entry]);
+    }
+
+public:
+    InfixIndex(StringInterner &interner = sharedInterner()) : names(&interner) {}
+
+    static constexpr uint32_t NO_ENTRY = numeric_limits<uint32_t>::max();
+
+    // Adds a name with its popularity and a caller id (e.g. a Graph node
+    // id). Returns the name's entry number, or NO_ENTRY if the interner
+    // is full.
+    uint32_t add(string_view name, uint32_t score = 0, uint32_t payload = NO_PAYLOAD) {
+        Symbol sym = names->intern(name);
+        if (sym == NO_SYMBOL) {
+            return NO_ENTRY;
+        }
+        uint32_t id = entries.size();
+        size_t offset = keys.size();
+        appendFoldedKey(name, keys);
+        Entry e{sym, payload, score, (uint32_t)offset, (uint32_t)(keys.size() - offset)};
+        entries.push_back(e);
+        string_view key = keyOf(e);
+        for (size_t i = 0; i + 3 <= key.size(); i++) {
+            PostingList &list = postings[gramAt(key, i)];
+            if (list.count == 0 || list.last != id) list.push(id);
+        }
+        // A short gram ranks the name at its first occurrence
+        for (size_t len = 1; len < 3; len++) {
+            for (size_t i = 0; i + len <= key.size(); i++) {
+                if (key.find(key.substr(i, len)) != i) continue;
+                Hit hit{(uint64_t)score << 32 | (uint32_t)~i, id};
+                keepBest(shortBest[shortGramAt(key, i, len)], hit, SHORT_TOP);
+            }
+        }
+        return id;
+    }
+
+    // Names whose folded key contains the folded query anywhere, highest
+    // score first and then earliest match, with payload and score
+    vector<TrieMatch> searchMatches(const string &query, size_t k) const {
+        vector<TrieMatch> out;
+        topK(query, k, [&](const Entry &e) { out.push_back({e.word, e.payload, e.score}); });
+        return out;
+    }
+
+    vector<string> search(const string &query, size_t k = 10) const {
+        vector<string> out;
+        topK(query, k, [&](const Entry &e) { out.push_back(string(names->view(e.word))); });
+        return out;
+    }
+
+    string_view nameOf(Symbol sym) const { return names->view(sym); }
+
+    size_t size() const { return entries.size(); }
+    size_t trigramCount() const { return postings.size(); }
+
+    // Encoded posting lists alone, and as plain 32-bit ids would take
+    size_t postingBytes() const {
+        size_t bytes = 0;
+        for (auto &p : postings) bytes += p.second.bytes.size();
+        return bytes;
+    }
+    size_t uncompressedPostingBytes() const {
+        size_t bytes = 0;
+        for (auto &p : postings) bytes += p.second.count * sizeof(uint32_t);
+        return bytes;
+    }
+
+    // Posting lists with their skips, short-gram hits, entries and folded keys
+    size_t memoryBytes() const {
+        size_t bytes = entries.capacity() * sizeof(Entry) + keys.capacity();
+        for (auto &p : postings) {
+            bytes += sizeof(p) + p.second.bytes.capacity() +
+                     p.second.skips.capacity() * sizeof(pair<uint32_t, uint32_t>);
+        }
+        for (auto &p : shortBest) bytes += sizeof(p) + p.second.capacity() * sizeof(Hit);
+        return bytes;
+    }
+};
+
+// ===================================================================
+// GRAPH - Adjacency List with Dijkstra's, BFS, DFS
+// Time Complexity: Dijkstra's O((V+E)log V), BFS/DFS O(V+E)
 // ===================================================================
 
-struct AVLNode {
-    string key;
-    int value;
-    AVLNode* left;
-    AVLNode* right;
-    int height;
-    
-    AVLNode(string k, int v) : key(k), value(v), left(nullptr), right(nullptr), height(1) {}
+class Graph;
+
+// Shortest-path result: node ids, the cost of every leg and the running
+// distance at each node. Names are resolved on demand through the graph,
+// so producing a result never copies a string.
+struct PathResult {
+    vector<int> nodes;       // node ids from source to destination
+    vector<int> legCosts;    // legCosts[i] = weight of nodes[i] -> nodes[i+1]
+    vector<int> prefixDist;  // prefixDist[i] = distance from source to nodes[i]
+    const Graph* graph = nullptr;
+
+    void clear() {
+        nodes.clear();
+        legCosts.clear();
+        prefixDist.clear();
+    }
+
+    bool empty() const { return nodes.empty(); }
+    size_t legCount() const { return legCosts.size(); }
+    int totalDistance() const { return prefixDist.empty() ? INF : prefixDist.back(); }
+
+    // View into the interned name table; valid as long as the interner
+    string_view nameAt(size_t i) const;
 };
 
-class AVLTree {
+class Graph {
 private:
-    AVLNode* root;
-    
-    int getHeight(AVLNode* node) {
-        return node ? node->height : 0;
-    }
-    
-    int getBalance(AVLNode* node) {
-        return node ? getHeight(node->left) - getHeight(node->right) : 0;
-    }
-    
-    AVLNode* rightRotate(AVLNode* y) {
-        AVLNode* x = y->left;
-        AVLNode* T2 = x->right;
-        
-        x->right = y;
-        y->left = T2;
+    StringInterner* names;
+    // Keys are views into the interner arena; lookups ignore case
+    unordered_map<string_view, int, FoldedHash, FoldedEqual> nameToNode;
+    vector<Symbol> nodeToName;
+    vector<vector<pair<int, int>>> adj;
+    WriteAheadLog* log;
+
+    // Node id for name, added if new; -1 if the interner is full
+    int internLocation(string_view name) {
+        int existing = findLocation(name);
+        if (existing != -1) {
+            return existing;
+        }
         
-        y->height = max(getHeight(y->left), getHeight(y->right)) + 1;
-        x->height = max(getHeight(x->left), getHeight(x->right)) + 1;
+        Symbol sym = names->intern(name);
+        if (sym == NO_SYMBOL) {
+            return -1;
+        }
+        int id = nodeToName.size();
+        nameToNode[names->view(sym)] = id;
+        nodeToName.push_back(sym);
+        adj.push_back({});
         
-        return x;
+        return id;
     }
-    
-    AVLNode* leftRotate(AVLNode* x) {
-        AVLNode* y = x->right;
-        AVLNode* T2 = y->left;
-        
-        y->left = x;
-        x->right = T2;
-        
-        x->height = max(getHeight(x->left), getHeight(x->right)) + 1;
-        y->height = max(getHeight(y->left), getHeight(y->right)) + 1;
+
+    void DFSHelper(int u, vector<bool> &visited, vector<string> &result) {
+        visited[u] = true;
+        result.push_back(string(getLocationName(u)));
         
-        return y;
+        for (auto &edge : adj[u]) {
+            int v = edge.first;
+            if (!visited[v]) {
+                DFSHelper(v, visited, result);
+            }
+        }
     }
-    
-    AVLNode* insertHelper(AVLNode* node, string key, int value) {
-        if (!node) {
-            return new AVLNode(key, value);
+
+public:
+    Graph(StringInterner &interner = sharedInterner()) : names(&interner), log(nullptr) {}
+
+    // Every mutation is appended to wal before it is applied. Pass nullptr
+    // to detach.
+    void attachLog(WriteAheadLog* wal) {
+        log = wal;
+    }
+
+    // Returns the node id, or -1 if the interner is full
+    int addLocation(string name) {
+        if (names->intern(name) == NO_SYMBOL) {
+            return -1;
         }
-        
-        if (key < node->key) {
-            node->left = insertHelper(node->left, key, value);
-        } else if (key > node->key) {
-            node->right = insertHelper(node->right, key, value);
-        } else {
-            node->value = value;
-            return node;
+        if (log && findLocation(name) == -1) {
+            log->append(LOG_ADD_LOCATION, name);
         }
-        
-        node->height = 1 + max(getHeight(node->left), getHeight(node->right));
-        int balance = getBalance(node);
-        
-        if (balance > 1 && key < node->left->key) {
-            return rightRotate(node);
+        return internLocation(name);
+    }
+
+    // Returns false, changing nothing, if either name cannot be interned
+    bool addEdge(string uName, string vName, int w) {
+        if (names->intern(uName) == NO_SYMBOL || names->intern(vName) == NO_SYMBOL) {
+            return false;
         }
+        if (log) log->append(LOG_ADD_EDGE, uName, vName, w);
+        int u = internLocation(uName);
+        int v = internLocation(vName);
         
-        if (balance < -1 && key > node->right->key) {
-            return leftRotate(node);
+        for (auto& edge : adj[u]) {
+            if (edge.first == v) {
+                edge.second = w;
+                for (auto& revEdge : adj[v]) {
+                    if (revEdge.first == u) {
+                        revEdge.second = w;
+                        break;
+                    }
+                }
+                return true;
+            }
         }
         
-        if (balance > 1 && key > node->left->key) {
-            node->left = leftRotate(node->left);
-            return rightRotate(node);
+        adj[u].push_back({v, w});
+        adj[v].push_back({u, w});
+        return true;
+    }
+
+    bool hasLocation(string name) {
+        return findLocation(name) != -1;
+    }
+
+    string getActualLocationName(string name) {
+        int id = findLocation(name);
+        return (id != -1) ? string(getLocationName(id)) : name;
+    }
+
+    // Case-insensitive lookup; returns -1 if the location is unknown
+    int findLocation(string_view name) const {
+        auto it = nameToNode.find(name);
+        return (it != nameToNode.end()) ? it->second : -1;
+    }
+
+    Symbol getLocationSymbol(int id) const {
+        return nodeToName[id];
+    }
+
+    string_view getLocationName(int id) const {
+        return names->view(nodeToName[id]);
+    }
+
+    bool shortestPath(int s, int t, PathResult &out) const {
+        out.clear();
+        out.graph = this;
+
+        int n = nodeToName.size();
+        if (s < 0 || t < 0 || s >= n || t >= n) {
+            return false;
         }
-        
-        if (balance < -1 && key < node->right->key) {
-            node->right = rightRotate(node->right);
-            return leftRotate(node);
+
+        vector<int> dist(n, INF);
+        vector<int> parent(n, -1);
+        vector<int> parentWeight(n, 0);
+        vector<bool> visited(n, false);
+
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+
+        dist[s] = 0;
+        pq.push({0, s});
+
+        while (!pq.empty()) {
+            auto cur = pq.top();
+            pq.pop();
+            int u = cur.second;
+
+            if (visited[u]) continue;
+            visited[u] = true;
+            if (u == t) break;
+
+            for (auto &edge : adj[u]) {
+                int v = edge.first;
+                int w = edge.second;
+
+                if (dist[u] + w < dist[v]) {
+                    dist[v] = dist[u] + w;
+                    parent[v] = u;
+                    parentWeight[v] = w;
+                    pq.push({dist[v], v});
+                }
+            }
         }
-        
-        return node;
+
+        if (dist[t] == INF) {
+            return false;
+        }
+
+        for (int cur = t; cur != -1; cur = parent[cur]) {
+            out.nodes.push_back(cur);
+            out.prefixDist.push_back(dist[cur]);
+            if (parent[cur] != -1) {
+                out.legCosts.push_back(parentWeight[cur]);
+            }
+        }
+
+        reverse(out.nodes.begin(), out.nodes.end());
+        reverse(out.legCosts.begin(), out.legCosts.end());
+        reverse(out.prefixDist.begin(), out.prefixDist.end());
+
+        return true;
     }
-    
-    AVLNode* minValueNode(AVLNode* node) {
-        AVLNode* current = node;
-        while (current->left) {
-            current = current->left;
+
+    bool shortestPath(string srcName, string destName, vector<string> &pathOut, int &distOut) {
+        pathOut.clear();
+        distOut = INF;
+
+        PathResult result;
+        if (!shortestPath(findLocation(srcName), findLocation(destName), result)) {
+            return false;
         }
-        return current;
+
+        for (size_t i = 0; i < result.nodes.size(); i++) {
+            pathOut.push_back(string(result.nameAt(i)));
+        }
+        distOut = result.totalDistance();
+
+        return true;
+    }
+
+    vector<string> BFS(string startName) {
+        vector<string> result;
+        int start = findLocation(startName);
+        if (start == -1) {
+            return result;
+        }
+
+        int n = nodeToName.size();
+        
+        vector<bool> visited(n, false);
+        queue<int> q;
+        
+        visited[start] = true;
+        q.push(start);
+        
+        while (!q.empty()) {
+            int u = q.front();
+            q.pop();
+            result.push_back(string(getLocationName(u)));
+            
+            for (auto &edge : adj[u]) {
+                int v = edge.first;
+                if (!visited[v]) {
+                    visited[v] = true;
+                    q.push(v);
+                }
+            }
+        }
+        
+        return result;
+    }
+
+    vector<string> DFS(string startName) {
+        vector<string> result;
+        int start = findLocation(startName);
+        if (start == -1) {
+            return result;
+        }
+
+        int n = nodeToName.size();
+        
+        vector<bool> visited(n, false);
+        DFSHelper(start, visited, result);
+        
+        return result;
+    }
+
+    bool isConnected() {
+        if (nodeToName.empty()) return true;
+        
+        int n = nodeToName.size();
+        vector<bool> visited(n, false);
+        queue<int> q;
+        
+        visited[0] = true;
+        q.push(0);
+        
+        while (!q.empty()) {
+            int u = q.front();
+            q.pop();
+            
+            for (auto &edge : adj[u]) {
+                int v = edge.first;
+                if (!visited[v]) {
+                    visited[v] = true;
+                    q.push(v);
+                }
+            }
+        }
+        
+        for (bool v : visited) {
+            if (!v) return false;
+        }
+        return true;
+    }
+
+    // Visits each undirected edge once as (u, v, weight) with u < v
+    template <typename F>
+    void forEachEdge(F visit) const {
+        for (int u = 0; u < (int)adj.size(); u++) {
+            for (auto &edge : adj[u]) {
+                if (u < edge.first) visit(u, edge.first, edge.second);
+            }
+        }
+    }
+
+    int getNodeCount() const { return nodeToName.size(); }
+    int getEdgeCount() {
+        int count = 0;
+        for (auto& edges : adj) {
+            count += edges.size();
+        }
+        return count / 2;
+    }
+};
+
+string_view PathResult::nameAt(size_t i) const {
+    return graph->getLocationName(nodes[i]);
+}
+
+// ===================================================================
+// LINKED LIST - Bus Route Management
+// Stops live in a per-route pool as a doubly linked list, so appends are
+// O(1) via head/tail and a freshly built route is laid out contiguously.
+// Reversal only flips a direction bit: traversals read the same storage
+// forwards or backwards. Stops are addressed by stable handles (pool
+// slots), and a lazily built stop -> handles index makes edits O(1).
+// Time Complexity: O(1) append/delete/reverse/size, amortized O(log n)
+// insert in the middle (order relabelling), O(n) traverse
+// ===================================================================
+
+// Stop and route handles pack a slot index in the low 32 bits and that
+// slot's generation above it. Freeing a slot bumps its generation, so a
+// handle kept past its removal fails validation instead of silently
+// addressing whatever reuses the slot.
+inline long long packHandle(int slot, uint32_t generation) {
+    return (long long)generation << 32 | (uint32_t)slot;
+}
+inline int handleSlot(long long h) { return (int)(uint32_t)h; }
+inline uint32_t handleGeneration(long long h) { return (uint32_t)(h >> 32); }
+inline uint32_t nextGeneration(uint32_t g) { return (g + 1) & 0x7FFFFFFF; }
+
+// A stop inside its route. Stays valid until that stop is removed,
+// regardless of other edits or reversal.
+using StopHandle = long long;
+const StopHandle NO_STOP = -1;
+
+struct Stop {
+    Symbol name;  // NO_SYMBOL while the slot is free
+    int prev;     // previous stop in storage order, -1 at the head
+    int next;     // next stop in storage order, -1 at the tail
+    int coord;    // storage-order number, consecutive unless coordsDirty
+    uint32_t generation;  // bumped each time the slot is freed
+    long long order;  // sparse storage-order label, always increasing
+    
+    Stop(Symbol n) : name(n), prev(-1), next(-1), coord(0), generation(0), order(0) {}
+};
+
+class BusRoute {
+public:
+    string routeName;
+
+private:
+    vector<Stop> pool;
+    int head;
+    int tail;
+    int count;
+    int freeList;      // unused pool slots, chained through Stop::next
+    bool reversed;     // route is read tail -> head
+    bool coordsDirty;  // a middle edit left gaps or duplicates in coords
+    bool stopsIndexed;
+    // Built on the first lookup so append-only routes never pay for it
+    unordered_map<Symbol, vector<int>> handlesByStop;  // stop -> pool slots
+
+    int allocate(Symbol n) {
+        if (freeList != -1) {
+            int slot = freeList;
+            freeList = pool[slot].next;
+            uint32_t generation = pool[slot].generation;
+            pool[slot] = Stop(n);
+            pool[slot].generation = generation;
+            return slot;
+        }
+        pool.push_back(Stop(n));
+        return pool.size() - 1;
+    }
+
+    void release(int slot) {
+        pool[slot].name = NO_SYMBOL;
+        pool[slot].generation = nextGeneration(pool[slot].generation);
+        pool[slot].next = freeList;
+        freeList = slot;
+    }
+
+    void ensureStopIndex() {
+        if (stopsIndexed) return;
+        for (int cur = head; cur != -1; cur = pool[cur].next) {
+            handlesByStop[pool[cur].name].push_back(cur);
+        }
+        stopsIndexed = true;
+    }
+
+    static constexpr long long ORDER_GAP = 1LL << 20;
+
+    // Makes room for a label right after `at` by re-spacing only a local
+    // window: the shortest run of j successors whose labels span more than
+    // j * j is spread evenly, or, if none does before the tail, everything
+    // up to the tail is re-spaced ORDER_GAP apart (labels past the tail are
+    // free). Amortized O(log n) labels touched per insert.
+    void relabelAfter(int at) {
+        long long base = pool[at].order;
+        int last = pool[at].next;
+        long long j = 1;  // successors of at up to and including last
+        while (pool[last].order - base <= j * j) {
+            if (pool[last].next == -1) {
+                long long order = base;
+                for (int cur = pool[at].next; cur != -1; cur = pool[cur].next) {
+                    order += ORDER_GAP;
+                    pool[cur].order = order;
+                }
+                return;
+            }
+            last = pool[last].next;
+            j++;
+        }
+        long long step = (pool[last].order - base) / j;
+        long long order = base;
+        for (int cur = pool[at].next; cur != last; cur = pool[cur].next) {
+            order += step;
+            pool[cur].order = order;
+        }
+    }
+
+    void ensureCoords() {
+        if (!coordsDirty) return;
+        int coord = 0;
+        for (int cur = head; cur != -1; cur = pool[cur].next) {
+            pool[cur].coord = coord++;
+        }
+        coordsDirty = false;
+    }
+
+    // Links node right after `at` in storage order; at == -1 means new head
+    void linkAfter(int at, int node) {
+        int nx = (at == -1) ? head : pool[at].next;
+        if (at != -1 && nx != -1 && pool[nx].order - pool[at].order < 2) {
+            relabelAfter(at);
+        }
+        if (count == 0) {
+            pool[node].order = 0;
+        } else if (nx == -1) {
+            pool[node].order = pool[at].order + ORDER_GAP;
+        } else if (at == -1) {
+            pool[node].order = pool[nx].order - ORDER_GAP;
+        } else {
+            pool[node].order = pool[at].order + (pool[nx].order - pool[at].order) / 2;
+        }
+
+        pool[node].prev = at;
+        pool[node].next = nx;
+        if (at == -1) head = node; else pool[at].next = node;
+        if (nx == -1) tail = node; else pool[nx].prev = node;
+
+        if (count == 0) {
+            pool[node].coord = 0;
+        } else if (nx == -1) {
+            pool[node].coord = pool[at].coord + 1;
+        } else if (at == -1) {
+            pool[node].coord = pool[nx].coord - 1;
+        } else {
+            coordsDirty = true;
+        }
+        count++;
+    }
+
+    StopHandle handleOf(int slot) const {
+        return (slot == -1) ? NO_STOP : packHandle(slot, pool[slot].generation);
+    }
+
+    StopHandle insertNode(int at, Symbol n) {
+        int node = allocate(n);
+        linkAfter(at, node);
+        if (stopsIndexed) {
+            handlesByStop[n].push_back(node);
+        }
+        return handleOf(node);
+    }
+
+public:
+    BusRoute()
+        : head(-1), tail(-1), count(0), freeList(-1), reversed(false),
+          coordsDirty(false), stopsIndexed(false) {}
+    BusRoute(string rn)
+        : routeName(rn), head(-1), tail(-1), count(0), freeList(-1), reversed(false),
+          coordsDirty(false), stopsIndexed(false) {}
+
+    // Appends in the current direction; on a reversed route this prepends
+    // in storage order
+    StopHandle addStop(Symbol n) {
+        return insertNode(reversed ? -1 : tail, n);
+    }
+
+    // Inserts next to `at` in the current direction
+    StopHandle insertAfter(StopHandle at, Symbol n) {
+        if (!isValid(at)) return NO_STOP;
+        int slot = handleSlot(at);
+        return insertNode(reversed ? pool[slot].prev : slot, n);
+    }
+
+    StopHandle insertBefore(StopHandle at, Symbol n) {
+        if (!isValid(at)) return NO_STOP;
+        int slot = handleSlot(at);
+        return insertNode(reversed ? slot : pool[slot].prev, n);
+    }
+
+    void reserve(int stops) {
+        pool.reserve(stops);
+    }
+
+    bool isValid(StopHandle h) const {
+        int slot = handleSlot(h);
+        return h >= 0 && slot < (int)pool.size() && pool[slot].name != NO_SYMBOL &&
+               pool[slot].generation == handleGeneration(h);
+    }
+
+    // The given occurrence (0 = first) of n in the current direction, or
+    // NO_STOP. O(stops named n on this route).
+    StopHandle findStop(Symbol n, int occurrence = 0) {
+        ensureStopIndex();
+        auto it = handlesByStop.find(n);
+        if (it == handlesByStop.end() || occurrence < 0 || occurrence >= (int)it->second.size()) {
+            return NO_STOP;
+        }
+        const vector<int> &hs = it->second;
+        auto before = [&](int a, int b) {
+            return reversed ? pool[a].order > pool[b].order : pool[a].order < pool[b].order;
+        };
+        if (occurrence == 0) {
+            return handleOf(*min_element(hs.begin(), hs.end(), before));
+        }
+        vector<int> ranked(hs);
+        nth_element(ranked.begin(), ranked.begin() + occurrence, ranked.end(), before);
+        return handleOf(ranked[occurrence]);
+    }
+
+    // Which occurrence of its name h is in the current direction, so
+    // findStop(stopAt(h), occurrenceOf(h)) == h. O(stops sharing the name).
+    int occurrenceOf(StopHandle h) {
+        ensureStopIndex();
+        const Stop &s = pool[handleSlot(h)];
+        int occurrence = 0;
+        for (int other : handlesByStop[s.name]) {
+            if (reversed ? pool[other].order > s.order : pool[other].order < s.order) {
+                occurrence++;
+            }
+        }
+        return occurrence;
+    }
+
+    bool eraseStop(StopHandle handle) {
+        if (!isValid(handle)) return false;
+
+        int h = handleSlot(handle);
+        int p = pool[h].prev;
+        int nx = pool[h].next;
+        if (p == -1) head = nx; else pool[p].next = nx;
+        if (nx == -1) tail = p; else pool[nx].prev = p;
+        if (p != -1 && nx != -1) {
+            coordsDirty = true;
+        }
+
+        if (stopsIndexed) {
+            vector<int> &hs = handlesByStop[pool[h].name];
+            hs.erase(find(hs.begin(), hs.end(), h));
+            if (hs.empty()) {
+                handlesByStop.erase(pool[h].name);
+            }
+        }
+        release(h);
+        count--;
+        return true;
+    }
+
+    // Removes the first occurrence in the current direction
+    bool deleteStop(Symbol n) {
+        return eraseStop(findStop(n));
+    }
+
+    void reverseRoute() {
+        reversed = !reversed;
+    }
+
+    bool isReversed() const { return reversed; }
+
+    Symbol stopAt(StopHandle h) const { return pool[handleSlot(h)].name; }
+
+    // Handle-based traversal in the current direction
+    StopHandle firstStop() const { return handleOf(reversed ? tail : head); }
+    StopHandle nextStop(StopHandle h) const {
+        const Stop &s = pool[handleSlot(h)];
+        return handleOf(reversed ? s.prev : s.next);
+    }
+    StopHandle prevStop(StopHandle h) const {
+        const Stop &s = pool[handleSlot(h)];
+        return handleOf(reversed ? s.next : s.prev);
+    }
+
+    // Visits stops in the current direction, or against it if backward is set
+    template <typename F>
+    void forEachStop(F visit, bool backward = false) const {
+        bool fromTail = reversed != backward;
+        for (int cur = fromTail ? tail : head; cur != -1;
+             cur = fromTail ? pool[cur].prev : pool[cur].next) {
+            visit(pool[cur].name);
+        }
+    }
+
+    // 0-based position of h in the current direction. O(1) unless a middle
+    // edit happened since the last call, which renumbers once in O(n); no
+    // edit or index path calls it.
+    int positionOf(StopHandle h) {
+        ensureCoords();
+        int pos = pool[handleSlot(h)].coord - pool[head].coord;
+        return reversed ? (count - 1 - pos) : pos;
+    }
+
+    vector<Symbol> getStopsVector(bool backward = false) const {
+        vector<Symbol> v;
+        v.reserve(count);
+        forEachStop([&](Symbol s) { v.push_back(s); }, backward);
+        return v;
+    }
+
+    int size() const { return count; }
+};
+
+// A route inside BusRouteManager. Valid until that route is deleted;
+// resolving a name once and reusing the handle skips the name hash on
+// every later call.
+using RouteHandle = long long;
+const RouteHandle NO_ROUTE = -1;
+
+// Occurrence of a stop on a route: both handles stay valid across other
+// edits, so the index never has to renumber anything
+struct StopRef {
+    RouteHandle route;
+    StopHandle stop;
+};
+
+class BusRouteManager {
+private:
+    StringInterner* names;
+    vector<BusRoute> routes;          // slot -> route
+    vector<Symbol> routeSymbols;      // slot -> interned name, NO_SYMBOL if free
+    vector<uint32_t> generations;     // slot -> bumped each time the route is deleted
+    vector<int> freeSlots;
+
+    // Index entry: stop handles are stable across every edit, so only the
+    // inserted or removed stop's own entry ever changes
+    struct StopEntry {
+        int route;  // slot
+        StopHandle stop;
+    };
+
+    // Keys are views into the interner arena, so lookups take a string_view
+    // and never build a temporary string
+    unordered_map<string_view, int> routeIndex;  // name -> slot
+    // Inverted index: every (route, stop handle) serving a stop, by a stop
+    // id dense to this manager, so it grows with the stops on its routes
+    // rather than with a shared interner. Built on the first query, like
+    // BusRoute's stop index, so bulk ingest never pays for it.
+    unordered_map<Symbol, int> stopIds;
+    vector<vector<StopEntry>> stopIndex;
+    bool stopsIndexed;
+    vector<Symbol> batchSymbols;  // addStops() scratch
+    WriteAheadLog* log;
+
+    // Private helpers take slots of routes already validated
+    string_view routeName(int h) const { return names->view(routeSymbols[h]); }
+
+    vector<StopEntry> &refsFor(Symbol s) {
+        auto it = stopIds.find(s);
+        if (it == stopIds.end()) {
+            it = stopIds.emplace(s, (int)stopIndex.size()).first;
+            stopIndex.emplace_back();
+        }
+        return stopIndex[it->second];
+    }
+
+    void ensureStopIndex() {
+        if (stopsIndexed) return;
+        for (int h = 0; h < (int)routes.size(); h++) {
+            if (routeSymbols[h] == NO_SYMBOL) continue;
+            const BusRoute &route = routes[h];
+            for (StopHandle stop = route.firstStop(); stop != NO_STOP; stop = route.nextStop(stop)) {
+                refsFor(route.stopAt(stop)).push_back({h, stop});
+            }
+        }
+        stopsIndexed = true;
+    }
+
+    void unindexRoute(int h) {
+        if (!stopsIndexed) return;
+        routes[h].forEachStop([&](Symbol s) {
+            vector<StopEntry> &refs = refsFor(s);
+            refs.erase(remove_if(refs.begin(), refs.end(),
+                                 [h](const StopEntry &e) { return e.route == h; }),
+                       refs.end());
+        });
+    }
+
+    void appendStop(int h, Symbol sym) {
+        StopHandle stop = routes[h].addStop(sym);
+        if (stopsIndexed) refsFor(sym).push_back({h, stop});
+    }
+
+    void unindexStop(int h, Symbol sym, StopHandle stop) {
+        if (!stopsIndexed) return;
+        vector<StopEntry> &refs = refsFor(sym);
+        for (size_t i = 0; i < refs.size(); i++) {
+            if (refs[i].route == h && refs[i].stop == stop) {
+                refs.erase(refs.begin() + i);
+                break;
+            }
+        }
+    }
+
+    StopHandle insertStop(RouteHandle handle, StopHandle at, string_view s, bool after) {
+        if (!isValid(handle) || !routes[handleSlot(handle)].isValid(at)) {
+            return NO_STOP;
+        }
+        int h = handleSlot(handle);
+        Symbol sym = names->intern(s);
+        if (sym == NO_SYMBOL) {
+            return NO_STOP;
+        }
+        if (log) {
+            log->append(LOG_INSERT_STOP, routeName(h), s, routes[h].occurrenceOf(at), after,
+                        names->view(routes[h].stopAt(at)));
+        }
+        StopHandle stop = after ? routes[h].insertAfter(at, sym) : routes[h].insertBefore(at, sym);
+        if (stopsIndexed) refsFor(sym).push_back({h, stop});
+        return stop;
+    }
+
+public:
+    BusRouteManager(StringInterner &interner = sharedInterner())
+        : names(&interner), stopsIndexed(false), log(nullptr) {}
+
+    // Every mutation is appended to wal before it is applied; edits by
+    // stop handle are logged as the stop's name and which occurrence of
+    // that name it is, so logging never renumbers the route. Pass nullptr
+    // to detach.
+    void attachLog(WriteAheadLog* wal) {
+        log = wal;
+    }
+
+    RouteHandle findRoute(string_view rn) const {
+        auto it = routeIndex.find(rn);
+        return (it != routeIndex.end()) ? packHandle(it->second, generations[it->second]) : NO_ROUTE;
+    }
+
+    bool isValid(RouteHandle h) const {
+        int slot = handleSlot(h);
+        return h >= 0 && slot < (int)routes.size() && routeSymbols[slot] != NO_SYMBOL &&
+               generations[slot] == handleGeneration(h);
+    }
+
+    bool addRoute(string_view rn) {
+        if (findRoute(rn) != NO_ROUTE) {
+            return false;
+        }
+        Symbol sym = names->intern(rn);
+        if (sym == NO_SYMBOL) {
+            return false;
+        }
+        if (log) log->append(LOG_ADD_ROUTE, rn);
+        int h;
+        if (!freeSlots.empty()) {
+            h = freeSlots.back();
+            freeSlots.pop_back();
+            routes[h] = BusRoute(string(rn));
+            routeSymbols[h] = sym;
+        } else {
+            h = routes.size();
+            routes.push_back(BusRoute(string(rn)));
+            routeSymbols.push_back(sym);
+            generations.push_back(0);
+        }
+        routeIndex.emplace(names->view(sym), h);
+        return true;
+    }
+
+    bool addStopToRoute(RouteHandle handle, string_view s) {
+        if (!isValid(handle)) {
+            return false;
+        }
+        int h = handleSlot(handle);
+        Symbol sym = names->intern(s);
+        if (sym == NO_SYMBOL) {
+            return false;
+        }
+        if (log) log->append(LOG_APPEND_STOP, routeName(h), s);
+        appendStop(h, sym);
+        return true;
+    }
+
+    bool addStopToRoute(string_view rn, string_view s) {
+        return addStopToRoute(findRoute(rn), s);
+    }
+
+    // Bulk append of stops already interned in this manager's interner:
+    // one handle check and one reservation for the whole batch. Stops up
+    // to the first invalid symbol are appended; false if there was one.
+    bool addStops(RouteHandle handle, const Symbol* stops, size_t count) {
+        if (!isValid(handle)) {
+            return false;
+        }
+        int h = handleSlot(handle);
+        Symbol limit = names->size();
+        routes[h].reserve(routes[h].size() + count);
+        for (size_t i = 0; i < count; i++) {
+            if (stops[i] >= limit) {
+                return false;
+            }
+            if (log) log->append(LOG_APPEND_STOP, routeName(h), names->view(stops[i]));
+            appendStop(h, stops[i]);
+        }
+        return true;
+    }
+
+    // Interns the whole batch under one lock pass, then appends it. If a
+    // stop name cannot be interned, the stops before it stay appended and
+    // false is returned.
+    bool addStops(RouteHandle handle, const string_view* stops, size_t count) {
+        if (!isValid(handle)) {
+            return false;
+        }
+        batchSymbols.resize(count);
+        names->internAll(stops, count, batchSymbols.data());
+        return addStops(handle, batchSymbols.data(), count);
+    }
+
+    bool addStops(RouteHandle h, const vector<string_view> &stops) {
+        return addStops(h, stops.data(), stops.size());
+    }
+
+    // The given occurrence (0 = first) of s in the route's current direction
+    StopHandle findStop(RouteHandle h, string_view s, int occurrence = 0) {
+        Symbol sym = names->find(s);
+        if (!isValid(h) || sym == NO_SYMBOL) {
+            return NO_STOP;
+        }
+        return routes[handleSlot(h)].findStop(sym, occurrence);
+    }
+
+    // Inserts next to an existing stop, in the route's current direction
+    StopHandle insertStopAfter(RouteHandle h, StopHandle at, string_view s) {
+        return insertStop(h, at, s, true);
+    }
+
+    StopHandle insertStopBefore(RouteHandle h, StopHandle at, string_view s) {
+        return insertStop(h, at, s, false);
+    }
+
+    bool insertStopAfter(string_view rn, string_view existing, string_view s) {
+        RouteHandle h = findRoute(rn);
+        return insertStopAfter(h, findStop(h, existing), s) != NO_STOP;
+    }
+
+    bool insertStopBefore(string_view rn, string_view existing, string_view s) {
+        RouteHandle h = findRoute(rn);
+        return insertStopBefore(h, findStop(h, existing), s) != NO_STOP;
+    }
+
+    // Stop at a 0-based position in the current direction: O(position)
+    StopHandle stopAtPosition(RouteHandle h, int pos) const {
+        if (!isValid(h) || pos < 0) {
+            return NO_STOP;
+        }
+        const BusRoute &route = routes[handleSlot(h)];
+        StopHandle stop = route.firstStop();
+        while (stop != NO_STOP && pos-- > 0) {
+            stop = route.nextStop(stop);
+        }
+        return stop;
+    }
+
+    bool eraseStop(RouteHandle handle, StopHandle stop) {
+        if (!isValid(handle) || !routes[handleSlot(handle)].isValid(stop)) {
+            return false;
+        }
+        int h = handleSlot(handle);
+        if (log) {
+            log->append(LOG_ERASE_STOP, routeName(h), names->view(routes[h].stopAt(stop)),
+                        routes[h].occurrenceOf(stop));
+        }
+        unindexStop(h, routes[h].stopAt(stop), stop);
+        return routes[h].eraseStop(stop);
+    }
+
+    bool deleteStopFromRoute(RouteHandle h, string_view s) {
+        return eraseStop(h, findStop(h, s));
+    }
+
+    bool deleteStopFromRoute(string_view rn, string_view s) {
+        return deleteStopFromRoute(findRoute(rn), s);
+    }
+
+    bool deleteRoute(string_view rn) {
+        auto it = routeIndex.find(rn);
+        if (it == routeIndex.end()) {
+            return false;
+        }
+        int h = it->second;
+        if (log) log->append(LOG_DELETE_ROUTE, rn);
+        unindexRoute(h);
+        routeIndex.erase(it);
+        routes[h] = BusRoute();
+        routeSymbols[h] = NO_SYMBOL;
+        generations[h] = nextGeneration(generations[h]);
+        freeSlots.push_back(h);
+        return true;
+    }
+
+    // O(1): flips the route's direction; the index is unaffected
+    bool reverseRoute(RouteHandle h) {
+        if (!isValid(h)) {
+            return false;
+        }
+        if (log) log->append(LOG_REVERSE_ROUTE, routeName(handleSlot(h)));
+        routes[handleSlot(h)].reverseRoute();
+        return true;
+    }
+
+    bool reverseRoute(string_view rn) {
+        return reverseRoute(findRoute(rn));
+    }
+
+    vector<string> getAllRouteNames() const {
+        vector<string> routeNames;
+        for (auto& pair : routeIndex) {
+            routeNames.push_back(string(pair.first));
+        }
+        return routeNames;
+    }
+
+    // Visits (name, route) for every live route in handle order
+    template <typename F>
+    void forEachRoute(F visit) const {
+        for (int h = 0; h < (int)routes.size(); h++) {
+            if (routeSymbols[h] != NO_SYMBOL) visit(routeName(h), routes[h]);
+        }
+    }
+
+    // Read-only access for copy-free traversal via BusRoute::forEachStop
+    // and the handle-based firstStop()/nextStop()
+    const BusRoute* getRoute(RouteHandle h) const {
+        return isValid(h) ? &routes[handleSlot(h)] : nullptr;
+    }
+
+    // backward reads the route against its current direction without
+    // reversing it
+    vector<string> getRouteStops(string_view rn, bool backward = false) const {
+        const BusRoute* route = getRoute(findRoute(rn));
+        if (!route) {
+            return {};
+        }
+        vector<string> stops;
+        stops.reserve(route->size());
+        route->forEachStop([&](Symbol sym) {
+            stops.push_back(string(names->view(sym)));
+        }, backward);
+        return stops;
+    }
+
+    vector<Symbol> getRouteStopSymbols(string_view rn, bool backward = false) const {
+        const BusRoute* route = getRoute(findRoute(rn));
+        return route ? route->getStopsVector(backward) : vector<Symbol>();
+    }
+
+    // Every (route, stop) handle pair serving the stop: O(occurrences), after
+    // a one-off O(total stops) index build on the first call
+    vector<StopRef> getRoutesServingStop(string_view s) {
+        ensureStopIndex();
+        auto it = stopIds.find(names->find(s));
+        if (it == stopIds.end()) {
+            return {};
+        }
+        const vector<StopEntry> &entries = stopIndex[it->second];
+        vector<StopRef> refs;
+        refs.reserve(entries.size());
+        for (const StopEntry &e : entries) {
+            refs.push_back({packHandle(e.route, generations[e.route]), e.stop});
+        }
+        return refs;
+    }
+
+    // 0-based position of a stop along its route, or -1 if either handle is
+    // stale. O(1), except that the first call after a middle edit to that
+    // route renumbers it in O(route length).
+    int stopPosition(RouteHandle h, StopHandle stop) {
+        if (!isValid(h) || !routes[handleSlot(h)].isValid(stop)) {
+            return -1;
+        }
+        return routes[handleSlot(h)].positionOf(stop);
+    }
+
+    string_view routeNameOf(RouteHandle h) const {
+        return isValid(h) ? routeName(handleSlot(h)) : string_view();
+    }
+
+    string_view nameOf(Symbol sym) const { return names->view(sym); }
+};
+
+// ===================================================================
+// TRANSIT ROUTING - RAPTOR over Bus Route Timetables
+// Time Complexity: O(K * (sum of route lengths + boarding searches)) per
+// query, K = number of rounds (max transfers + 1)
+// ===================================================================
+
+// Trips per bus route: stopTimes[i] is the time (seconds after midnight) the
+// trip serves the route's i-th stop. Trips are matched against the route's
+// stops when a TransitRouter is built.
+class Timetable {
+private:
+    unordered_map<string, vector<vector<int>>> trips;
+    int count;
+
+public:
+    Timetable() : count(0) {}
+
+    bool addTrip(const string &routeName, const vector<int> &stopTimes) {
+        if (stopTimes.empty()) return false;
+        for (size_t i = 1; i < stopTimes.size(); i++) {
+            if (stopTimes[i] < stopTimes[i - 1]) return false;
+        }
+        trips[routeName].push_back(stopTimes);
+        count++;
+        return true;
+    }
+
+    const vector<vector<int>>* getTrips(const string &routeName) const {
+        auto it = trips.find(routeName);
+        return (it != trips.end()) ? &it->second : nullptr;
+    }
+
+    int tripCount() const { return count; }
+};
+
+struct JourneyLeg {
+    Symbol route;
+    Symbol fromStop;
+    Symbol toStop;
+    int departure;
+    int arrival;
+};
+
+struct Journey {
+    int departure;
+    int arrival;
+    int transfers;
+    vector<JourneyLeg> legs;
+};
+
+class TransitRouter {
+private:
+    struct Label {
+        int arrival;
+        int route;     // -1 if this is the query origin
+        int trip;
+        int boardPos;
+        int alightPos;
+        int round;     // round in which the label was set
+    };
+
+    StringInterner* names;
+    unordered_map<Symbol, int> stopIndex;
+    vector<Symbol> stopSymbols;
+
+    // Flat route arrays. Stops of route r are
+    // routeStops[routeStopOffset[r] .. routeStopOffset[r + 1]); the time of
+    // trip t at position p is stopTimes[routeTimeOffset[r] + t * length + p].
+    // Trips are sorted by departure and never overtake each other.
+    vector<Symbol> routeNames;
+    vector<int> routeStopOffset;
+    vector<int> routeStops;
+    vector<int> routeTripCount;
+    vector<int> routeTimeOffset;
+    vector<int> stopTimes;
+
+    // (route, position) pairs serving stop s:
+    // stopRoutes[stopRouteOffset[s] .. stopRouteOffset[s + 1])
+    vector<int> stopRouteOffset;
+    vector<pair<int, int>> stopRoutes;
+
+    int droppedTrips;
+
+    int routeLength(int r) const {
+        return routeStopOffset[r + 1] - routeStopOffset[r];
+    }
+
+    int timeAt(int r, int trip, int pos) const {
+        return stopTimes[routeTimeOffset[r] + trip * routeLength(r) + pos];
+    }
+
+    int stopId(Symbol sym) {
+        auto it = stopIndex.find(sym);
+        if (it != stopIndex.end()) {
+            return it->second;
+        }
+        int id = stopSymbols.size();
+        stopIndex[sym] = id;
+        stopSymbols.push_back(sym);
+        return id;
+    }
+
+    int findStop(string_view name) const {
+        Symbol sym = names->find(name);
+        if (sym == NO_SYMBOL) return -1;
+        auto it = stopIndex.find(sym);
+        return (it != stopIndex.end()) ? it->second : -1;
+    }
+
+    // Earliest trip among the first `limit` trips of r that can be boarded
+    // at pos no earlier than time t, or -1
+    int earliestTrip(int r, int pos, int t, int limit) const {
+        int lo = 0, hi = limit;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (timeAt(r, mid, pos) >= t) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return (lo < limit) ? lo : -1;
+    }
+
+    void scan(int src, int dst, int departTime, int maxRounds, vector<vector<Label>> &rounds) const {
+        int n = stopSymbols.size();
+        int routeCount = routeTripCount.size();
+        const Label unreached = {INF, -1, -1, -1, -1, 0};
+
+        vector<int> best(n, INF);
+        vector<char> marked(n, 0);
+        vector<int> markedStops;
+        vector<int> routeFrom(routeCount, -1);
+        vector<int> queued;
+
+        rounds.assign(1, vector<Label>(n, unreached));
+        rounds[0][src].arrival = departTime;
+        best[src] = departTime;
+        marked[src] = 1;
+        markedStops.push_back(src);
+
+        for (int k = 1; k <= maxRounds && !markedStops.empty(); k++) {
+            rounds.push_back(rounds[k - 1]);
+            const vector<Label> &prev = rounds[k - 1];
+            vector<Label> &cur = rounds[k];
+
+            for (int s : markedStops) {
+                marked[s] = 0;
+                for (int i = stopRouteOffset[s]; i < stopRouteOffset[s + 1]; i++) {
+                    int r = stopRoutes[i].first;
+                    int pos = stopRoutes[i].second;
+                    if (routeFrom[r] == -1) {
+                        queued.push_back(r);
+                        routeFrom[r] = pos;
+                    } else {
+                        routeFrom[r] = min(routeFrom[r], pos);
+                    }
+                }
+            }
+            markedStops.clear();
+
+            for (int r : queued) {
+                int len = routeLength(r);
+                int base = routeStopOffset[r];
+                int trip = -1;
+                int boardPos = -1;
+
+                for (int p = routeFrom[r]; p < len; p++) {
+                    int stop = routeStops[base + p];
+
+                    if (trip != -1) {
+                        int arr = timeAt(r, trip, p);
+                        if (arr < min(best[stop], best[dst])) {
+                            cur[stop] = {arr, r, trip, boardPos, p, k};
+                            best[stop] = arr;
+                            if (!marked[stop]) {
+                                marked[stop] = 1;
+                                markedStops.push_back(stop);
+                            }
+                        }
+                    }
+
+                    int ready = prev[stop].arrival;
+                    if (ready != INF && (trip == -1 || ready <= timeAt(r, trip, p))) {
+                        int limit = (trip == -1) ? routeTripCount[r] : trip + 1;
+                        int t = earliestTrip(r, p, ready, limit);
+                        if (t != -1 && t != trip) {
+                            trip = t;
+                            boardPos = p;
+                        }
+                    }
+                }
+                routeFrom[r] = -1;
+            }
+            queued.clear();
+        }
+    }
+
+    Journey reconstruct(const vector<vector<Label>> &rounds, int round, int dst) const {
+        Journey j;
+        j.arrival = rounds[round][dst].arrival;
+
+        int stop = dst;
+        Label l = rounds[round][dst];
+        while (l.route != -1) {
+            int r = l.route;
+            int from = routeStops[routeStopOffset[r] + l.boardPos];
+            j.legs.push_back({routeNames[r], stopSymbols[from], stopSymbols[stop],
+                              timeAt(r, l.trip, l.boardPos), timeAt(r, l.trip, l.alightPos)});
+            stop = from;
+            l = rounds[l.round - 1][from];
+        }
+
+        reverse(j.legs.begin(), j.legs.end());
+        j.departure = j.legs.empty() ? j.arrival : j.legs.front().departure;
+        j.transfers = j.legs.empty() ? 0 : (int)j.legs.size() - 1;
+        return j;
+    }
+
+public:
+    TransitRouter(StringInterner &interner = sharedInterner()) : names(&interner), droppedTrips(0) {}
+
+    // Flattens every route of brm that has at least one trip in tt. Trips
+    // whose length does not match the route, or that would overtake an
+    // earlier trip, are dropped and counted.
+    void build(BusRouteManager &brm, const Timetable &tt) {
+        stopIndex.clear();
+        stopSymbols.clear();
+        routeNames.clear();
+        routeStopOffset.assign(1, 0);
+        routeStops.clear();
+        routeTripCount.clear();
+        routeTimeOffset.clear();
+        stopTimes.clear();
+        droppedTrips = 0;
+
+        vector<vector<pair<int, int>>> servedBy;
+
+        for (const string &rn : brm.getAllRouteNames()) {
+            const vector<vector<int>>* trips = tt.getTrips(rn);
+            if (!trips) continue;
+
+            vector<Symbol> stops = brm.getRouteStopSymbols(rn);
+            if (stops.size() < 2) {
+                droppedTrips += trips->size();
+                continue;
+            }
+
+            vector<const vector<int>*> valid;
+            for (auto &trip : *trips) {
+                if (trip.size() == stops.size()) {
+                    valid.push_back(&trip);
+                } else {
+                    droppedTrips++;
+                }
+            }
+            sort(valid.begin(), valid.end(), [](const vector<int>* a, const vector<int>* b) {
+                return a->front() < b->front();
+            });
+
+            vector<const vector<int>*> fifo;
+            for (auto trip : valid) {
+                bool overtakes = false;
+                if (!fifo.empty()) {
+                    for (size_t p = 0; p < stops.size(); p++) {
+                        if ((*trip)[p] < (*fifo.back())[p]) {
+                            overtakes = true;
+                            break;
+                        }
+                    }
+                }
+                if (overtakes) {
+                    droppedTrips++;
+                } else {
+                    fifo.push_back(trip);
+                }
+            }
+            if (fifo.empty()) continue;
+
+            int r = routeNames.size();
+            routeNames.push_back(names->intern(rn));
+            routeTripCount.push_back(fifo.size());
+            routeTimeOffset.push_back(stopTimes.size());
+            for (size_t p = 0; p < stops.size(); p++) {
+                int s = stopId(stops[p]);
+                routeStops.push_back(s);
+                if ((int)servedBy.size() <= s) {
+                    servedBy.resize(s + 1);
+                }
+                servedBy[s].push_back({r, (int)p});
+            }
+            routeStopOffset.push_back(routeStops.size());
+            for (auto trip : fifo) {
+                stopTimes.insert(stopTimes.end(), trip->begin(), trip->end());
+            }
+        }
+
+        stopRouteOffset.assign(1, 0);
+        stopRoutes.clear();
+        servedBy.resize(stopSymbols.size());
+        for (auto &list : servedBy) {
+            stopRoutes.insert(stopRoutes.end(), list.begin(), list.end());
+            stopRouteOffset.push_back(stopRoutes.size());
+        }
+    }
+
+    // Pareto set of (arrival, transfers): each journey arrives strictly
+    // earlier than every journey with fewer transfers
+    vector<Journey> paretoJourneys(string_view from, string_view to, int departTime, int maxTransfers = 4) const {
+        vector<Journey> result;
+        int src = findStop(from);
+        int dst = findStop(to);
+        if (src == -1 || dst == -1) {
+            return result;
+        }
+        if (src == dst) {
+            result.push_back({departTime, departTime, 0, {}});
+            return result;
+        }
+
+        vector<vector<Label>> rounds;
+        scan(src, dst, departTime, maxTransfers + 1, rounds);
+
+        for (size_t k = 1; k < rounds.size(); k++) {
+            if (rounds[k][dst].arrival < rounds[k - 1][dst].arrival) {
+                result.push_back(reconstruct(rounds, k, dst));
+            }
+        }
+        return result;
+    }
+
+    bool earliestArrival(string_view from, string_view to, int departTime, Journey &out, int maxTransfers = 4) const {
+        vector<Journey> journeys = paretoJourneys(from, to, departTime, maxTransfers);
+        if (journeys.empty()) {
+            return false;
+        }
+        out = journeys.back();
+        return true;
+    }
+
+    string_view nameOf(Symbol sym) const { return names->view(sym); }
+
+    int getStopCount() const { return stopSymbols.size(); }
+    int getRouteCount() const { return routeTripCount.size(); }
+    int getDroppedTrips() const { return droppedTrips; }
+};
+
+// ===================================================================
+// QUEUE - Lock-free MPSC Ring Buffers for Traffic Updates
+// Many feed threads push fixed-size records into one ring per severity;
+// one applier drains them earliest-deadline-first.
+// Time Complexity: O(1) for enqueue/dequeue
+// ===================================================================
+
+// Bounded multi-producer/single-consumer ring (Vyukov-style sequence per
+// cell). Producers claim a slot with one CAS on tail; the consumer owns head.
+template <typename T>
+class MPSCRingBuffer {
+private:
+    struct Cell {
+        atomic<size_t> seq;
+        T data;
+    };
+
+    unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) atomic<size_t> tail;
+    alignas(64) atomic<size_t> head;
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit MPSCRingBuffer(size_t capacity) : tail(0), head(0) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        cells.reset(new Cell[cap]);
+        mask = cap - 1;
+        for (size_t i = 0; i < cap; i++) {
+            cells[i].seq.store(i, memory_order_relaxed);
+        }
+    }
+
+    MPSCRingBuffer(const MPSCRingBuffer&) = delete;
+    MPSCRingBuffer& operator=(const MPSCRingBuffer&) = delete;
+
+    // Safe from any number of threads; returns false if the ring is full
+    bool tryPush(const T &value) {
+        size_t pos = tail.load(memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[pos & mask];
+            size_t seq = cell.seq.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.data = value;
+                    cell.seq.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only
+    bool tryPop(T &out) {
+        size_t pos = head.load(memory_order_relaxed);
+        Cell &cell = cells[pos & mask];
+        size_t seq = cell.seq.load(memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+            return false;
+        }
+        out = cell.data;
+        cell.seq.store(pos + mask + 1, memory_order_release);
+        head.store(pos + 1, memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer thread only: next record without consuming it, or nullptr
+    const T* front() const {
+        size_t pos = head.load(memory_order_relaxed);
+        const Cell &cell = cells[pos & mask];
+        size_t seq = cell.seq.load(memory_order_acquire);
+        return ((intptr_t)seq - (intptr_t)(pos + 1) < 0) ? nullptr : &cell.data;
+    }
+
+    // Approximate while producers are active
+    size_t size() const {
+        size_t t = tail.load(memory_order_relaxed);
+        size_t h = head.load(memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+};
+
+enum TrafficLevel { LOW=1, MEDIUM=2, HIGH=3 };
+
+struct TrafficUpdate {
+    string routeName;
+    TrafficLevel level;
+    
+    TrafficUpdate(string r="", TrafficLevel l=LOW) : routeName(r), level(l) {}
+};
+
+// Route id dense to one TrafficManager, handed out by routeId() in the
+// order routes are first named
+using TrafficRouteId = uint32_t;
+const TrafficRouteId NO_TRAFFIC_ROUTE = numeric_limits<TrafficRouteId>::max();
+
+// Fixed-size queue record: route id instead of a heap string
+struct TrafficRecord {
+    TrafficRouteId route;
+    uint8_t level;
+    uint64_t timestamp;  // steady_clock nanoseconds at push
+};
+
+// What pushUpdate does when the ring is full
+enum Backpressure {
+    REJECT_WHEN_FULL,  // fail fast and count the update as rejected
+    WAIT_FOR_SPACE     // yield until the applier frees a slot
+};
+
+// Outcome of one bounded drain of the update ring
+struct DrainStats {
+    int drained;    // records taken off the ring
+    int applied;    // route levels written after coalescing
+    int coalesced;  // records superseded by a later update in the same batch
+};
+
+// Queueing delay of applied records for one severity level
+struct LevelStats {
+    long drained;
+    uint64_t totalDelayNs;
+    uint64_t maxDelayNs;
+    long deadlineMisses;  // records drained after their latency bound
+
+    double averageDelayNs() const { return drained ? (double)totalDelayNs / drained : 0; }
+};
+
+// Consistent copy of every route's level at one published version
+struct TrafficSnapshot {
+    uint64_t version;
+    vector<uint8_t> levels;  // indexed by route id, 0 = unknown
+
+    bool get(TrafficRouteId route, TrafficLevel &out) const {
+        if (route >= levels.size() || levels[route] == 0) return false;
+        out = (TrafficLevel)levels[route];
+        return true;
+    }
+};
+
+uint64_t monotonicNanos() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ===================================================================
+// TRAFFIC HISTORY - Columnar Time Series per Route
+// Append-only blocks of 256 samples: timestamps stored as zigzag varint
+// delta-of-deltas (one byte for any steady cadence), levels packed 2 bits
+// each, per-block level counts for aggregates. Blocks older than the
+// retention window are recycled ring-style.
+// Time Complexity: O(1) append, O(blocks + samples) range query,
+// O(blocks) aggregate over whole blocks
+// ===================================================================
+
+struct HistoryBlock {
+    static constexpr int CAPACITY = 256;
+    static constexpr int DELTA_BYTES = 384;
+    static constexpr int MAX_VARINT = 5;
+
+    uint64_t firstTs;
+    uint64_t lastTs;
+    uint32_t lastDelta;
+    uint16_t count;
+    uint16_t deltaUsed;
+    uint16_t levelCounts[3];
+    uint8_t levels[CAPACITY / 4];
+    uint8_t deltas[DELTA_BYTES];
+
+    void reset(uint64_t ts) {
+        firstTs = lastTs = ts;
+        lastDelta = 0;
+        count = 0;
+        deltaUsed = 0;
+        levelCounts[0] = levelCounts[1] = levelCounts[2] = 0;
+        memset(levels, 0, sizeof(levels));
+    }
+
+    bool hasRoom() const {
+        return count < CAPACITY && deltaUsed + MAX_VARINT <= DELTA_BYTES;
+    }
+
+    int levelAt(int i) const {
+        return (levels[i >> 2] >> ((i & 3) * 2)) & 3;
+    }
+
+    void push(uint64_t ts, int level) {
+        if (count > 0) {
+            uint32_t delta = (uint32_t)(ts - lastTs);
+            int32_t dod = (int32_t)(delta - lastDelta);
+            uint32_t zz = ((uint32_t)dod << 1) ^ (uint32_t)(dod >> 31);
+            while (zz >= 0x80) {
+                deltas[deltaUsed++] = (uint8_t)(zz | 0x80);
+                zz >>= 7;
+            }
+            deltas[deltaUsed++] = (uint8_t)zz;
+            lastDelta = delta;
+        }
+        levels[count >> 2] |= level << ((count & 3) * 2);
+        levelCounts[level]++;
+        count++;
+        lastTs = ts;
+    }
+
+    // Decodes samples in order; visit(timestamp, level)
+    template <typename F>
+    void forEach(F visit) const {
+        uint64_t ts = firstTs;
+        uint32_t delta = 0;
+        int off = 0;
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                uint32_t zz = 0;
+                int shift = 0;
+                uint8_t byte;
+                do {
+                    byte = deltas[off++];
+                    zz |= (uint32_t)(byte & 0x7f) << shift;
+                    shift += 7;
+                } while (byte & 0x80);
+                int32_t dod = (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1);
+                delta += (uint32_t)dod;
+                ts += delta;
+            }
+            visit(ts, levelAt(i));
+        }
+    }
+};
+
+// Count of each level in a time range and the mean level
+struct LevelSummary {
+    long counts[3];  // LOW, MEDIUM, HIGH
+
+    long total() const { return counts[0] + counts[1] + counts[2]; }
+    double meanLevel() const {
+        long n = total();
+        return n ? (counts[0] * 1.0 + counts[1] * 2.0 + counts[2] * 3.0) / n : 0;
+    }
+};
+
+// Timestamps are in seconds. Samples for a route must arrive in time
+// order; slightly late samples are clamped to the route's last timestamp.
+// Routes are keyed by the caller's id (a TrafficManager route id when
+// attached) and mapped to dense series slots, so any id space works.
+class TrafficHistory {
+private:
+    static constexpr size_t CHUNK_BITS = 12;  // blocks are allocated 4096 at a time
+
+    vector<unique_ptr<HistoryBlock[]>> chunks;
+    uint32_t blockCount;
+    vector<uint32_t> freeBlocks;
+    unordered_map<uint32_t, uint32_t> seriesOf;  // route id -> index into series
+    vector<vector<uint32_t>> series;             // blocks per route, oldest first
+    uint64_t retentionSec;
+    long samples;
+
+    HistoryBlock &block(uint32_t b) {
+        return chunks[b >> CHUNK_BITS][b & ((1u << CHUNK_BITS) - 1)];
+    }
+
+    const HistoryBlock &block(uint32_t b) const {
+        return chunks[b >> CHUNK_BITS][b & ((1u << CHUNK_BITS) - 1)];
+    }
+
+    uint32_t allocBlock(uint64_t ts) {
+        uint32_t b;
+        if (!freeBlocks.empty()) {
+            b = freeBlocks.back();
+            freeBlocks.pop_back();
+        } else {
+            b = blockCount++;
+            if ((b >> CHUNK_BITS) >= chunks.size()) {
+                chunks.emplace_back(new HistoryBlock[size_t(1) << CHUNK_BITS]);
+            }
+        }
+        block(b).reset(ts);
+        return b;
+    }
+
+    const vector<uint32_t>* seriesFor(uint32_t route) const {
+        auto it = seriesOf.find(route);
+        return (it != seriesOf.end()) ? &series[it->second] : nullptr;
+    }
+
+    // Frees leading blocks whose newest sample is older than cutoff
+    void evict(vector<uint32_t> &blocks, uint64_t cutoff) {
+        size_t drop = 0;
+        while (drop < blocks.size() && block(blocks[drop]).lastTs < cutoff) {
+            samples -= block(blocks[drop]).count;
+            freeBlocks.push_back(blocks[drop]);
+            drop++;
+        }
+        if (drop > 0) {
+            blocks.erase(blocks.begin(), blocks.begin() + drop);
+        }
+    }
+
+public:
+    explicit TrafficHistory(uint64_t retentionSeconds = 7 * 24 * 3600)
+        : blockCount(0), retentionSec(retentionSeconds), samples(0) {}
+
+    void append(uint32_t route, uint64_t ts, TrafficLevel level) {
+        auto it = seriesOf.find(route);
+        if (it == seriesOf.end()) {
+            it = seriesOf.emplace(route, (uint32_t)series.size()).first;
+            series.emplace_back();
+        }
+        vector<uint32_t> &blocks = series[it->second];
+
+        bool fresh = blocks.empty();
+        if (!fresh) {
+            const HistoryBlock &last = block(blocks.back());
+            ts = max(ts, last.lastTs);
+            fresh = !last.hasRoom() || ts - last.lastTs > INT32_MAX;
+        }
+        if (fresh) {
+            blocks.push_back(allocBlock(ts));
+        }
+
+        int lv = (level >= LOW && level <= HIGH) ? level - 1 : 0;
+        block(blocks.back()).push(ts, lv);
+        samples++;
+
+        if (ts > retentionSec) {
+            evict(blocks, ts - retentionSec);
+        }
+    }
+
+    // Enforces the retention window on every route, including routes that
+    // have stopped reporting and so never evict from append. O(routes +
+    // blocks freed).
+    void evictAll(uint64_t now) {
+        if (now <= retentionSec) return;
+        for (auto &blocks : series) {
+            evict(blocks, now - retentionSec);
+        }
+    }
+
+    // Samples with from <= timestamp <= to, oldest first
+    vector<pair<uint64_t, TrafficLevel>> range(uint32_t route, uint64_t from, uint64_t to) const {
+        vector<pair<uint64_t, TrafficLevel>> out;
+        const vector<uint32_t>* blocks = seriesFor(route);
+        if (!blocks) return out;
+        for (uint32_t b : *blocks) {
+            const HistoryBlock &blk = block(b);
+            if (blk.lastTs < from) continue;
+            if (blk.firstTs > to) break;
+            blk.forEach([&](uint64_t ts, int lv) {
+                if (ts >= from && ts <= to) {
+                    out.push_back({ts, (TrafficLevel)(lv + 1)});
+                }
+            });
+        }
+        return out;
+    }
+
+    // Blocks entirely inside the range are answered from their counters
+    LevelSummary aggregate(uint32_t route, uint64_t from, uint64_t to) const {
+        LevelSummary sum = {{0, 0, 0}};
+        const vector<uint32_t>* blocks = seriesFor(route);
+        if (!blocks) return sum;
+        for (uint32_t b : *blocks) {
+            const HistoryBlock &blk = block(b);
+            if (blk.lastTs < from) continue;
+            if (blk.firstTs > to) break;
+            if (blk.firstTs >= from && blk.lastTs <= to) {
+                for (int i = 0; i < 3; i++) sum.counts[i] += blk.levelCounts[i];
+            } else {
+                blk.forEach([&](uint64_t ts, int lv) {
+                    if (ts >= from && ts <= to) sum.counts[lv]++;
+                });
+            }
+        }
+        return sum;
+    }
+
+    long sampleCount() const { return samples; }
+    // Blocks in use, per-route block lists and the route map; chunk slack
+    // (at most one partially used chunk of 4096 blocks) is not counted
+    size_t memoryBytes() const {
+        size_t bytes = (size_t)(blockCount - freeBlocks.size()) * sizeof(HistoryBlock) +
+                       freeBlocks.capacity() * sizeof(uint32_t) +
+                       seriesOf.size() * (sizeof(pair<uint32_t, uint32_t>) + 2 * sizeof(void*)) +
+                       seriesOf.bucket_count() * sizeof(void*);
+        for (auto &blocks : series) {
+            bytes += sizeof(blocks) + blocks.capacity() * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+};
+
+class TrafficManager {
+private:
+    static constexpr int LEVELS = 3;
+
+    StringInterner* names;
+    // One ring per TrafficLevel (index level - 1), so a flood of LOW
+    // refreshes can neither delay nor fill up the ring for HIGH alerts
+    unique_ptr<MPSCRingBuffer<TrafficRecord>> queues[LEVELS];
+    uint64_t latencyBoundNs[LEVELS];
+    LevelStats levelStats[LEVELS];
+    Backpressure policy;
+    atomic<long> rejected;
+
+    // Published state for readers: one atomic byte per route id
+    // (0 = unknown) in fixed pages that are allocated once and never move,
+    // so lookups need no lock. `version` is a seqlock: odd while a batch
+    // is being applied, so bulk readers can detect a torn snapshot.
+    static constexpr size_t STATE_PAGE_BITS = 16;
+    static constexpr size_t STATE_PAGE_SIZE = size_t(1) << STATE_PAGE_BITS;
+    static constexpr size_t MAX_STATE_PAGES = 1024;  // 64M routes
+    struct StatePage {
+        atomic<uint8_t> levels[STATE_PAGE_SIZE];
+        Symbol names[STATE_PAGE_SIZE];  // written once, before the id is handed out
+    };
+    unique_ptr<atomic<StatePage*>[]> statePages;
+    atomic<uint64_t> version;
+
+    // Route ids are dense per manager, so the pages and the per-route
+    // vectors below grow with this manager's routes rather than with
+    // every symbol in a shared interner
+    mutable shared_mutex routeLock;
+    unordered_map<Symbol, TrafficRouteId> routeIds;
+    atomic<TrafficRouteId> routeCount;
+
+    // Applier-only: timestamp of the update behind each route's level, so
+    // stale records never win
+    vector<uint64_t> updatedAt;
+    long coalescedTotal;
+
+    // Per-batch dedup: batchSlot[route] is valid when slotEpoch[route] == epoch
+    vector<TrafficRecord> batch;
+    vector<int> batchSlot;
+    vector<uint32_t> slotEpoch;
+    uint32_t epoch;
+    vector<uint64_t> deadlines[LEVELS];
+    TrafficHistory* history;
+    uint64_t historySweptAt;  // wall-clock second of the last evictAll
+    WriteAheadLog* log;
+
+    // Ids never handed out by routeId() (including NO_TRAFFIC_ROUTE from a
+    // full interner or id space) are rejected at the door, so the drain
+    // never sees them
+    bool inRange(TrafficRouteId route) const {
+        return route < routeCount.load(memory_order_acquire);
+    }
+
+    void ensureRoute(TrafficRouteId route) {
+        if (route >= updatedAt.size()) {
+            size_t n = max<size_t>(route + 1, updatedAt.size() * 2);
+            updatedAt.resize(n, 0);
+            batchSlot.resize(n, 0);
+            slotEpoch.resize(n, 0);
+        }
+    }
+
+    StatePage* statePage(TrafficRouteId route) const {
+        if ((route >> STATE_PAGE_BITS) >= MAX_STATE_PAGES) return nullptr;
+        return statePages[route >> STATE_PAGE_BITS].load(memory_order_acquire);
+    }
+
+    atomic<uint8_t>* stateSlot(TrafficRouteId route) const {
+        StatePage* page = statePage(route);
+        return page ? &page->levels[route & (STATE_PAGE_SIZE - 1)] : nullptr;
+    }
+
+    // Caller holds routeLock exclusively
+    TrafficRouteId addRouteLocked(Symbol name) {
+        auto it = routeIds.find(name);
+        if (it != routeIds.end()) {
+            return it->second;
+        }
+        TrafficRouteId id = routeCount.load(memory_order_relaxed);
+        size_t page = id >> STATE_PAGE_BITS;
+        if (page >= MAX_STATE_PAGES) {
+            return NO_TRAFFIC_ROUTE;
+        }
+        StatePage* p = statePages[page].load(memory_order_relaxed);
+        if (!p) {
+            p = new StatePage();
+            statePages[page].store(p, memory_order_release);
+        }
+        p->names[id & (STATE_PAGE_SIZE - 1)] = name;
+        routeIds.emplace(name, id);
+        routeCount.store(id + 1, memory_order_release);
+        return id;
+    }
+
+    // Seqlock read: retries until fn ran without a batch being applied
+    template <typename F>
+    uint64_t consistentRead(F fn) const {
+        for (;;) {
+            uint64_t before = version.load(memory_order_acquire);
+            if (before & 1) {
+                this_thread::yield();
+                continue;
+            }
+            fn();
+            atomic_thread_fence(memory_order_acquire);
+            if (version.load(memory_order_relaxed) == before) {
+                return before / 2;
+            }
+        }
+    }
+
+    void nextEpoch() {
+        if (++epoch == 0) {
+            fill(slotEpoch.begin(), slotEpoch.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    static int levelIndex(TrafficLevel level) {
+        return (level >= LOW && level <= HIGH) ? level - 1 : 0;
+    }
+
+    // Level whose head record has the earliest deadline (-1 if all rings
+    // are empty); runnerUp receives the earliest deadline among the others
+    int earliestDeadline(uint64_t &runnerUp) const {
+        int pick = -1;
+        uint64_t best = UINT64_MAX;
+        runnerUp = UINT64_MAX;
+        for (int i = 0; i < LEVELS; i++) {
+            const TrafficRecord* head = queues[i]->front();
+            if (!head) continue;
+            uint64_t deadline = head->timestamp + latencyBoundNs[i];
+            if (deadline < best) {
+                runnerUp = best;
+                pick = i;
+                best = deadline;
+            } else if (deadline < runnerUp) {
+                runnerUp = deadline;
+            }
+        }
+        return pick;
+    }
+
+public:
+    TrafficManager(size_t capacity = 1 << 16, Backpressure bp = WAIT_FOR_SPACE,
+                   StringInterner &interner = sharedInterner())
+        : names(&interner), policy(bp), rejected(0),
+          statePages(new atomic<StatePage*>[MAX_STATE_PAGES]), version(0), routeCount(0),
+          coalescedTotal(0), epoch(0), history(nullptr), historySweptAt(0), log(nullptr) {
+        for (size_t i = 0; i < MAX_STATE_PAGES; i++) {
+            statePages[i].store(nullptr, memory_order_relaxed);
+        }
+        const uint64_t defaultBounds[LEVELS] = {500000000, 50000000, 5000000};  // LOW, MEDIUM, HIGH
+        for (int i = 0; i < LEVELS; i++) {
+            queues[i].reset(new MPSCRingBuffer<TrafficRecord>(capacity));
+            latencyBoundNs[i] = defaultBounds[i];
+            levelStats[i] = {0, 0, 0, 0};
+        }
+    }
+
+    ~TrafficManager() {
+        for (size_t i = 0; i < MAX_STATE_PAGES; i++) {
+            delete statePages[i].load(memory_order_relaxed);
+        }
+    }
+
+    TrafficManager(const TrafficManager&) = delete;
+    TrafficManager& operator=(const TrafficManager&) = delete;
+
+    // Target queueing delay for a level; drain order is earliest deadline
+    // (push time + bound) first, so HIGH wins until LOW records age out
+    void setLatencyBound(TrafficLevel level, uint64_t ns) {
+        latencyBoundNs[levelIndex(level)] = ns;
+    }
+
+    LevelStats getLevelStats(TrafficLevel level) const {
+        return levelStats[levelIndex(level)];
+    }
+
+    // Every drained record (before coalescing) is also appended to h,
+    // stamped with wall-clock seconds, and the first drain in each
+    // wall-clock second runs h->evictAll. Pass nullptr to detach.
+    void attachHistory(TrafficHistory* h) {
+        history = h;
+        historySweptAt = 0;
+    }
+
+    // Every applied level (after coalescing) is appended to wal before it
+    // is published. Pass nullptr to detach.
+    void attachLog(WriteAheadLog* wal) {
+        log = wal;
+    }
+
+    // Sets a route's level directly, bypassing the queues; used to restore
+    // state on recovery. Any later update wins over it. Applier thread only.
+    // False for a route id out of range.
+    bool restoreLevel(TrafficRouteId route, TrafficLevel level) {
+        if (!inRange(route)) {
+            return false;
+        }
+        ensureRoute(route);
+        atomic<uint8_t>* slot = stateSlot(route);
+        if (!slot) {
+            return false;
+        }
+        uint64_t v = version.load(memory_order_relaxed);
+        version.store(v + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        slot->store((uint8_t)level, memory_order_relaxed);
+        updatedAt[route] = 0;
+        version.store(v + 2, memory_order_release);
+        return true;
+    }
+
+    // Name of a route id handed out by routeId()
+    string_view nameOf(TrafficRouteId route) const {
+        return names->view(statePage(route)->names[route & (STATE_PAGE_SIZE - 1)]);
+    }
+
+    // Resolve a route name once and push by id on the hot path; thread-safe.
+    // NO_TRAFFIC_ROUTE if the interner or the id space is full, which
+    // pushUpdate rejects.
+    TrafficRouteId routeId(string_view routeName) {
+        Symbol name = names->intern(routeName);
+        if (name == NO_SYMBOL) {
+            return NO_TRAFFIC_ROUTE;
+        }
+        {
+            shared_lock<shared_mutex> read(routeLock);
+            auto it = routeIds.find(name);
+            if (it != routeIds.end()) {
+                return it->second;
+            }
+        }
+        unique_lock<shared_mutex> write(routeLock);
+        return addRouteLocked(name);
+    }
+
+    // Id of a route already named, or NO_TRAFFIC_ROUTE
+    TrafficRouteId findRouteId(string_view routeName) const {
+        Symbol name = names->find(routeName);
+        if (name == NO_SYMBOL) {
+            return NO_TRAFFIC_ROUTE;
+        }
+        shared_lock<shared_mutex> read(routeLock);
+        auto it = routeIds.find(name);
+        return (it != routeIds.end()) ? it->second : NO_TRAFFIC_ROUTE;
+    }
+
+    // Thread-safe; returns false if the update was rejected (a full ring
+    // under REJECT_WHEN_FULL, or a route id out of range)
+    bool pushUpdate(TrafficRouteId route, TrafficLevel level) {
+        if (!inRange(route)) {
+            rejected.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        TrafficRecord r = {route, (uint8_t)level, monotonicNanos()};
+        MPSCRingBuffer<TrafficRecord> &ring = *queues[levelIndex(level)];
+        while (!ring.tryPush(r)) {
+            if (policy == REJECT_WHEN_FULL) {
+                rejected.fetch_add(1, memory_order_relaxed);
+                return false;
+            }
+            this_thread::yield();
+        }
+        return true;
+    }
+
+    bool pushUpdate(TrafficUpdate u) {
+        return pushUpdate(routeId(u.routeName), u.level);
+    }
+
+    // Takes at most maxBatch records, earliest deadline first across the
+    // level rings, keeps only the newest per route and applies the
+    // survivors with a single version bump. Bounding the batch keeps one
+    // call's work fixed however fast producers are pushing.
+    // Single applier thread only.
+    DrainStats drainUpdates(int maxBatch = 4096) {
+        DrainStats stats = {0, 0, 0};
+        nextEpoch();
+        batch.clear();
+
+        // Per-level delay bookkeeping: from the sum and minimum of push
+        // times, total and max delay follow from one clock read per batch
+        long taken[LEVELS] = {0, 0, 0};
+        uint64_t sumTs[LEVELS] = {0, 0, 0};
+        uint64_t minTs[LEVELS] = {0, 0, 0};
+        for (int i = 0; i < LEVELS; i++) {
+            deadlines[i].clear();
+        }
+
+        // Record timestamps are steady-clock; shift them onto the wall clock
+        uint64_t wallOffset = 0;
+        if (history) {
+            uint64_t wallNow = chrono::duration_cast<chrono::nanoseconds>(
+                chrono::system_clock::now().time_since_epoch()).count();
+            wallOffset = wallNow - monotonicNanos();
+            uint64_t wallSec = wallNow / 1000000000ULL;
+            if (wallSec != historySweptAt) {
+                history->evictAll(wallSec);
+                historySweptAt = wallSec;
+            }
+        }
+
+        TrafficRecord r;
+        uint64_t runnerUp;
+        int lvl = -1;
+        while (stats.drained < maxBatch) {
+            // Keep draining the current ring while its head is still due
+            // before every other ring's head; rescan the heads otherwise
+            const TrafficRecord* head = (lvl == -1) ? nullptr : queues[lvl]->front();
+            if (!head || head->timestamp + latencyBoundNs[lvl] > runnerUp) {
+                lvl = earliestDeadline(runnerUp);
+                if (lvl == -1) break;
+            }
+            queues[lvl]->tryPop(r);
+            stats.drained++;
+            if (taken[lvl] == 0 || r.timestamp < minTs[lvl]) minTs[lvl] = r.timestamp;
+            taken[lvl]++;
+            sumTs[lvl] += r.timestamp;
+            deadlines[lvl].push_back(r.timestamp + latencyBoundNs[lvl]);
+            if (history) {
+                history->append(r.route, (r.timestamp + wallOffset) / 1000000000ULL, (TrafficLevel)r.level);
+            }
+
+            ensureRoute(r.route);
+            if (slotEpoch[r.route] == epoch) {
+                TrafficRecord &kept = batch[batchSlot[r.route]];
+                if (r.timestamp >= kept.timestamp) {
+                    kept = r;
+                }
+            } else {
+                slotEpoch[r.route] = epoch;
+                batchSlot[r.route] = batch.size();
+                batch.push_back(r);
+            }
+        }
+
+        // Log the levels about to be applied before the version goes odd,
+        // so readers never spin while the WAL lock is held
+        if (log) {
+            for (const TrafficRecord &u : batch) {
+                if (stateSlot(u.route) && u.timestamp >= updatedAt[u.route]) {
+                    log->append(LOG_TRAFFIC, nameOf(u.route), {}, u.level);
+                }
+            }
+        }
+
+        // Odd version while writing; the fence orders the bump before the
+        // level stores so a reader that sees a new level also sees odd
+        uint64_t v = version.load(memory_order_relaxed);
+        bool publishing = false;
+        for (const TrafficRecord &u : batch) {
+            atomic<uint8_t>* slot = stateSlot(u.route);
+            if (slot && u.timestamp >= updatedAt[u.route]) {
+                if (!publishing) {
+                    version.store(v + 1, memory_order_relaxed);
+                    atomic_thread_fence(memory_order_release);
+                    publishing = true;
+                }
+                slot->store(u.level, memory_order_relaxed);
+                updatedAt[u.route] = u.timestamp;
+                stats.applied++;
+            }
+        }
+        if (publishing) {
+            version.store(v + 2, memory_order_release);
+        }
+
+        uint64_t now = monotonicNanos();
+        for (int i = 0; i < LEVELS; i++) {
+            if (taken[i] == 0) continue;
+            LevelStats &ls = levelStats[i];
+            ls.drained += taken[i];
+            ls.totalDelayNs += now * taken[i] - sumTs[i];
+            ls.maxDelayNs = max(ls.maxDelayNs, now - minTs[i]);
+            for (uint64_t d : deadlines[i]) {
+                if (d < now) ls.deadlineMisses++;
+            }
+        }
+
+        stats.coalesced = stats.drained - (int)batch.size();
+        coalescedTotal += stats.coalesced;
+        return stats;
+    }
+
+    // Drains until the ring is empty; returns the number of records taken.
+    // Single applier thread only.
+    int processUpdates() {
+        int count = 0;
+        const int BATCH = 4096;
+        for (;;) {
+            DrainStats stats = drainUpdates(BATCH);
+            count += stats.drained;
+            if (stats.drained < BATCH) break;
+        }
+        return count;
+    }
+
+    long coalescedCount() const { return coalescedTotal; }
+    // Number of batches applied so far
+    uint64_t publishedVersion() const { return version.load(memory_order_acquire) / 2; }
+
+    // Current level of one route: a single atomic load, safe from any
+    // thread while the applier drains. False if the route has no update yet.
+    bool getTrafficLevel(TrafficRouteId route, TrafficLevel &out) const {
+        const atomic<uint8_t>* slot = stateSlot(route);
+        uint8_t level = slot ? slot->load(memory_order_relaxed) : 0;
+        if (level == 0) return false;
+        out = (TrafficLevel)level;
+        return true;
+    }
+
+    bool getTrafficLevel(string_view routeName, TrafficLevel &out) const {
+        return getTrafficLevel(findRouteId(routeName), out);
+    }
+
+    // Levels of several routes as of one batch (0 = unknown); returns the
+    // version they were read at
+    uint64_t getTrafficLevels(const vector<TrafficRouteId> &routes, vector<uint8_t> &out) const {
+        out.resize(routes.size());
+        return consistentRead([&]() {
+            for (size_t i = 0; i < routes.size(); i++) {
+                const atomic<uint8_t>* slot = stateSlot(routes[i]);
+                out[i] = slot ? slot->load(memory_order_relaxed) : 0;
+            }
+        });
+    }
+
+    // Copy of every route's level, never mixing two batches
+    TrafficSnapshot snapshot() const {
+        TrafficSnapshot snap;
+        snap.version = consistentRead([&]() {
+            size_t count = routeCount.load(memory_order_acquire);
+            snap.levels.assign(count, 0);
+            for (size_t p = 0; p * STATE_PAGE_SIZE < count; p++) {
+                const StatePage* page = statePages[p].load(memory_order_acquire);
+                uint8_t* dst = &snap.levels[p * STATE_PAGE_SIZE];
+                size_t n = min(STATE_PAGE_SIZE, count - p * STATE_PAGE_SIZE);
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] = page->levels[i].load(memory_order_relaxed);
+                }
+            }
+        });
+        return snap;
+    }
+
+    int queueSize() {
+        size_t total = 0;
+        for (auto &q : queues) total += q->size();
+        return total;
+    }
+    bool isEmpty() { return queueSize() == 0; }
+    long rejectedCount() const { return rejected.load(memory_order_relaxed); }
+};
+
+// ===================================================================
+// WRITE-AHEAD LOG - Replay and Snapshots
+// Defined here because they drive Graph, BusRouteManager and TrafficManager
+// ===================================================================
+
+void WriteAheadLog::applyRecord(const LogRecord &r, Graph &graph, BusRouteManager &routes,
+                                TrafficManager &traffic) {
+    switch (r.type) {
+    case LOG_ADD_LOCATION:
+        graph.addLocation(string(r.a));
+        break;
+    case LOG_ADD_EDGE:
+        graph.addEdge(string(r.a), string(r.b), (int)r.value);
+        break;
+    case LOG_ADD_ROUTE:
+        routes.addRoute(r.a);
+        break;
+    case LOG_DELETE_ROUTE:
+        routes.deleteRoute(r.a);
+        break;
+    case LOG_REVERSE_ROUTE:
+        routes.reverseRoute(r.a);
+        break;
+    case LOG_APPEND_STOP:
+        routes.addStopToRoute(r.a, r.b);
+        break;
+    case LOG_INSERT_STOP: {
+        RouteHandle h = routes.findRoute(r.a);
+        StopHandle at = routes.findStop(h, r.c, (int)r.value);
+        if (r.flag) {
+            routes.insertStopAfter(h, at, r.b);
+        } else {
+            routes.insertStopBefore(h, at, r.b);
+        }
+        break;
+    }
+    case LOG_ERASE_STOP: {
+        RouteHandle h = routes.findRoute(r.a);
+        routes.eraseStop(h, routes.findStop(h, r.b, (int)r.value));
+        break;
+    }
+    case LOG_TRAFFIC:
+        if (r.value >= LOW && r.value <= HIGH) {
+            traffic.restoreLevel(traffic.routeId(r.a), (TrafficLevel)r.value);
+        }
+        break;
+    case LOG_SNAPSHOT:
+        break;
+    }
+}
+
+bool WriteAheadLog::recover(Graph &graph, BusRouteManager &routes, TrafficManager &traffic,
+                            RecoveryStats* stats) {
+    RecoveryStats local = {0, 0, 0};
+    RecoveryStats &st = stats ? *stats : local;
+    st = {0, 0, 0};
+    if (fd < 0) return false;
+
+    string buf;
+    uint64_t covered = 0;
+    if (readFile(snapshotPath, buf)) {
+        bool first = true;
+        bool valid = true;
+        size_t good = scan(buf, [&](const LogRecord &r) {
+            if (first) {
+                valid = r.type == LOG_SNAPSHOT;
+                covered = (uint64_t)r.value;
+                first = false;
+            }
+            if (!valid) return;
+            applyRecord(r, graph, routes, traffic);
+            st.snapshotRecords++;
+        });
+        // Snapshots are renamed into place only once complete and synced
+        if (!valid || good != buf.size()) return false;
+    }
+
+    uint64_t maxLsn = covered;
+    if (readFile(logPath, buf)) {
+        size_t good = scan(buf, [&](const LogRecord &r) {
+            if (r.lsn <= covered) return;  // already in the snapshot
+            applyRecord(r, graph, routes, traffic);
+            maxLsn = max(maxLsn, r.lsn);
+            st.logRecords++;
+        });
+        st.truncatedBytes = buf.size() - good;
+        if (good != buf.size() && (::ftruncate(fd, good) != 0 || ::fdatasync(fd) != 0)) {
+            return false;
+        }
+    }
+
+    lock_guard<mutex> lock(m);
+    lastLsn = durableLsn = maxLsn;
+    return true;
+}
+
+bool WriteAheadLog::checkpoint(const Graph &graph, const BusRouteManager &routes,
+                               const TrafficManager &traffic) {
+    if (!commit()) return false;
+
+    uint64_t covered = lastAppendedLsn();
+    string out;
+    encode(out, 0, LOG_SNAPSHOT, {}, {}, (int64_t)covered, 0);
+    // Locations in id order so node ids survive the restart
+    for (int id = 0; id < graph.getNodeCount(); id++) {
+        encode(out, 0, LOG_ADD_LOCATION, graph.getLocationName(id), {}, 0, 0);
+    }
+    graph.forEachEdge([&](int u, int v, int w) {
+        encode(out, 0, LOG_ADD_EDGE, graph.getLocationName(u), graph.getLocationName(v), w, 0);
+    });
+    routes.forEachRoute([&](string_view name, const BusRoute &route) {
+        encode(out, 0, LOG_ADD_ROUTE, name, {}, 0, 0);
+        route.forEachStop([&](Symbol stop) {
+            encode(out, 0, LOG_APPEND_STOP, name, routes.nameOf(stop), 0, 0);
+        });
+    });
+    TrafficSnapshot levels = traffic.snapshot();
+    for (size_t route = 0; route < levels.levels.size(); route++) {
+        if (levels.levels[route] != 0) {
+            encode(out, 0, LOG_TRAFFIC, traffic.nameOf((TrafficRouteId)route), {}, levels.levels[route], 0);
+        }
+    }
+
+    // Write aside, sync, then rename over the old snapshot so a crash at
+    // any point leaves one complete snapshot on disk
+    string tmpPath = snapshotPath + ".tmp";
+    int outFd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) return false;
+    bool ok = writeAll(outFd, out.data(), out.size()) && ::fsync(outFd) == 0;
+    ::close(outFd);
+    if (!ok || ::rename(tmpPath.c_str(), snapshotPath.c_str()) != 0) return false;
+    size_t slash = snapshotPath.rfind('/');
+    string dir = (slash == string::npos) ? "." : snapshotPath.substr(0, slash + 1);
+    int dirFd = ::open(dir.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+
+    // Records up to `covered` are in the snapshot; replay skips them by LSN
+    // if the process dies before the truncate lands
+    lock_guard<mutex> lock(m);
+    if (flushing) return true;  // a concurrent flush is writing; truncate next time
+    return ::ftruncate(fd, 0) == 0 && ::fdatasync(fd) == 0;
+}
+
+// ===================================================================
+// AVL TREE - Self-Balancing Binary Search Tree
+// Time Complexity: O(log n) for all operations
+// ===================================================================
+
+struct AVLNode {
+    string key;
+    int value;
+    AVLNode* left;
+    AVLNode* right;
+    int height;
+    
+    AVLNode(string k, int v) : key(k), value(v), left(nullptr), right(nullptr), height(1) {}
+};
+
+class AVLTree {
+private:
+    AVLNode* root;
+    
+    int getHeight(AVLNode* node) {
+        return node ? node->height : 0;
+    }
+    
+    int getBalance(AVLNode* node) {
+        return node ? getHeight(node->left) - getHeight(node->right) : 0;
+    }
+    
+    AVLNode* rightRotate(AVLNode* y) {
+        AVLNode* x = y->left;
+        AVLNode* T2 = x->right;
+        
+        x->right = y;
+        y->left = T2;
+        
+        y->height = max(getHeight(y->left), getHeight(y->right)) + 1;
+        x->height = max(getHeight(x->left), getHeight(x->right)) + 1;
+        
+        return x;
+    }
+    
+    AVLNode* leftRotate(AVLNode* x) {
+        AVLNode* y = x->right;
+        AVLNode* T2 = y->left;
+        
+        y->left = x;
+        x->right = T2;
+        
+        x->height = max(getHeight(x->left), getHeight(x->right)) + 1;
+        y->height = max(getHeight(y->left), getHeight(y->right)) + 1;
+        
+        return y;
+    }
+    
+    AVLNode* insertHelper(AVLNode* node, string key, int value) {
+        if (!node) {
+            return new AVLNode(key, value);
+        }
+        
+        if (key < node->key) {
+            node->left = insertHelper(node->left, key, value);
+        } else if (key > node->key) {
+            node->right = insertHelper(node->right, key, value);
+        } else {
+            node->value = value;
+            return node;
+        }
+        
+        node->height = 1 + max(getHeight(node->left), getHeight(node->right));
+        int balance = getBalance(node);
+        
+        if (balance > 1 && key < node->left->key) {
+            return rightRotate(node);
+        }
+        
+        if (balance < -1 && key > node->right->key) {
+            return leftRotate(node);
+        }
+        
+        if (balance > 1 && key > node->left->key) {
+            node->left = leftRotate(node->left);
+            return rightRotate(node);
+        }
+        
+        if (balance < -1 && key < node->right->key) {
+            node->right = rightRotate(node->right);
+            return leftRotate(node);
+        }
+        
+        return node;
+    }
+    
+    AVLNode* minValueNode(AVLNode* node) {
+        AVLNode* current = node;
+        while (current->left) {
+            current = current->left;
+        }
+        return current;
+    }
+    
+    AVLNode* deleteHelper(AVLNode* node, string key) {
+        if (!node) return node;
+        
+        if (key < node->key) {
+            node->left = deleteHelper(node->left, key);
+        } else if (key > node->key) {
+            node->right = deleteHelper(node->right, key);
+        } else {
+            if (!node->left || !node->right) {
+                AVLNode* temp = node->left ? node->left : node->right;
+                
+                if (!temp) {
+                    temp = node;
+                    node = nullptr;
+                } else {
+                    *node = *temp;
+                }
+                delete temp;
+            } else {
+                AVLNode* temp = minValueNode(node->right);
+                node->key = temp->key;
+                node->value = temp->value;
+                node->right = deleteHelper(node->right, temp->key);
+            }
+        }
+        
+        if (!node) return node;
+        
+        node->height = 1 + max(getHeight(node->left), getHeight(node->right));
+        int balance = getBalance(node);
+        
+        if (balance > 1 && getBalance(node->left) >= 0) {
+            return rightRotate(node);
+        }
+        
+        if (balance > 1 && getBalance(node->left) < 0) {
+            node->left = leftRotate(node->left);
+            return rightRotate(node);
+        }
+        
+        if (balance < -1 && getBalance(node->right) <= 0) {
+            return leftRotate(node);
+        }
+        
+        if (balance < -1 && getBalance(node->right) > 0) {
+            node->right = rightRotate(node->right);
+            return leftRotate(node);
+        }
+        
+        return node;
+    }
+    
+    AVLNode* searchHelper(AVLNode* node, string key) {
+        if (!node || node->key == key) {
+            return node;
+        }
+        
+        if (key < node->key) {
+            return searchHelper(node->left, key);
+        }
+        
+        return searchHelper(node->right, key);
+    }
+    
+    void inorderHelper(AVLNode* node, vector<pair<string, int>> &result) {
+        if (node) {
+            inorderHelper(node->left, result);
+            result.push_back({node->key, node->value});
+            inorderHelper(node->right, result);
+        }
+    }
+    
+    void destroyTree(AVLNode* node) {
+        if (node) {
+            destroyTree(node->left);
+            destroyTree(node->right);
+            delete node;
+        }
+    }
+
+    void printTreeHelper(AVLNode* node, int indent = 0) {
+        if (node) {
+            printTreeHelper(node->right, indent + 4);
+            for (int i = 0; i < indent; i++) cout << " ";
+            cout << node->key << "(" << node->value << ")" << endl;
+            printTreeHelper(node->left, indent + 4);
+        }
+    }
+
+public:
+    AVLTree() : root(nullptr) {}
+    
+    ~AVLTree() {
+        destroyTree(root);
+    }
+    
+    void insert(string key, int value) {
+        root = insertHelper(root, key, value);
+    }
+    
+    bool remove(string key) {
+        if (!search(key)) return false;
+        root = deleteHelper(root, key);
+        return true;
+    }
+    
+    int* search(string key) {
+        AVLNode* node = searchHelper(root, key);
+        return node ? &node->value : nullptr;
+    }
+    
+    vector<pair<string, int>> inorderTraversal() {
+        vector<pair<string, int>> result;
+        inorderHelper(root, result);
+        return result;
+    }
+    
+    bool isEmpty() {
+        return root == nullptr;
+    }
+
+    void printTree() {
+        if (root) {
+            printTreeHelper(root);
+        } else {
+            cout << "(Empty tree)" << endl;
+        }
+    }
+};
+
+// ===================================================================
+// CUSTOM HASH TABLE - Hash Table with Chaining
+// Time Complexity: O(1) average, O(n) worst case
+// ===================================================================
+
+struct HashNode {
+    string key;
+    int value;
+    HashNode* next;
+    
+    HashNode(string k, int v) : key(k), value(v), next(nullptr) {}
+};
+
+class CustomHashTable {
+private:
+    vector<HashNode*> table;
+    int capacity;
+    int size;
+    const double LOAD_FACTOR_THRESHOLD = 0.75;
+    
+    int hashFunction(string key) {
+        unsigned long hash = 5381;
+        for (char c : key) {
+            hash = ((hash << 5) + hash) + c;
+        }
+        return hash % capacity;
+    }
+    
+    void rehash() {
+        int oldCapacity = capacity;
+        capacity *= 2;
+        vector<HashNode*> newTable(capacity, nullptr);
+        
+        for (int i = 0; i < oldCapacity; i++) {
+            HashNode* node = table[i];
+            while (node) {
+                HashNode* next = node->next;
+                int newIndex = hashFunction(node->key);
+                node->next = newTable[newIndex];
+                newTable[newIndex] = node;
+                node = next;
+            }
+        }
+        
+        table = newTable;
+    }
+
+public:
+    CustomHashTable(int initialCapacity = 16) : capacity(initialCapacity), size(0) {
+        table.resize(capacity, nullptr);
+    }
+    
+    ~CustomHashTable() {
+        for (int i = 0; i < capacity; i++) {
+            HashNode* node = table[i];
+            while (node) {
+                HashNode* next = node->next;
+                delete node;
+                node = next;
+            }
+        }
+    }
+    
+    bool insert(string key, int value) {
+        int* existing = search(key);
+        if (existing) {
+            *existing = value;
+            return false;
+        }
+        
+        if ((double)size / capacity >= LOAD_FACTOR_THRESHOLD) {
+            rehash();
+        }
+        
+        int index = hashFunction(key);
+        HashNode* newNode = new HashNode(key, value);
+        newNode->next = table[index];
+        table[index] = newNode;
+        size++;
+        
+        return true;
+    }
+    
+    int* search(string key) {
+        int index = hashFunction(key);
+        HashNode* node = table[index];
+        
+        while (node) {
+            if (node->key == key) {
+                return &node->value;
+            }
+            node = node->next;
+        }
+        
+        return nullptr;
+    }
+    
+    bool remove(string key) {
+        int index = hashFunction(key);
+        HashNode* node = table[index];
+        HashNode* prev = nullptr;
+        
+        while (node) {
+            if (node->key == key) {
+                if (prev) {
+                    prev->next = node->next;
+                } else {
+                    table[index] = node->next;
+                }
+                delete node;
+                size--;
+                return true;
+            }
+            prev = node;
+            node = node->next;
+        }
+        
+        return false;
+    }
+    
+    int getSize() { return size; }
+    int getCapacity() { return capacity; }
+    double getLoadFactor() { return (double)size / capacity; }
+    bool isEmpty() { return size == 0; }
+    
+    vector<pair<string, int>> getAllEntries() {
+        vector<pair<string, int>> result;
+        for (int i = 0; i < capacity; i++) {
+            HashNode* node = table[i];
+            while (node) {
+                result.push_back({node->key, node->value});
+                node = node->next;
+            }
+        }
+        return result;
+    }
+
+    void printTable() {
+        cout << "Hash Table (Size: " << size << ", Capacity: " << capacity 
+             << ", Load Factor: " << getLoadFactor() << ")" << endl;
+        for (int i = 0; i < capacity; i++) {
+            if (table[i]) {
+                cout << "Bucket " << i << ": ";
+                HashNode* node = table[i];
+                while (node) {
+                    cout << "[" << node->key << ":" << node->value << "]";
+                    if (node->next) cout << " -> ";
+                    node = node->next;
+                }
+                cout << endl;
+            }
+        }
+    }
+};
+
+// ===================================================================
+// FLAT HASH TABLE - Open Addressing with Robin Hood Probing
+// Entries live in one slot array, with a parallel byte per slot holding
+// its distance from the home slot (0 = empty). An insert takes the slot
+// of any entry closer to home than itself and carries that one onward,
+// so probe lengths stay short and even; a lookup stops as soon as it
+// meets an entry closer to home than the probe. Removal shifts the
+// following displaced entries back one slot instead of leaving
+// tombstones.
+// Time Complexity: O(1) average insert/search/remove. Slots are inline
+// (no node per entry, unlike the chained table), but each key is a
+// std::string: keys longer than its small-string buffer (15 bytes in
+// libstdc++) still allocate their own characters.
+// ===================================================================
+
+class FlatHashTable {
+private:
+    struct Slot {
+        string key;
+        int value;
+        uint32_t hash;
+    };
+
+    static constexpr uint8_t MAX_DISTANCE = 255;
+    const double LOAD_FACTOR_THRESHOLD = 0.875;
+
+    vector<Slot> slots;
+    vector<uint8_t> distance;  // 1 + probe distance, 0 for an empty slot
+    int capacity;              // power of two
+    int size;
+    int shift;                 // 32 - log2(capacity)
+
+    // djb2, spread over the top bits by Fibonacci hashing so a
+    // power-of-two table can index with a shift
+    static uint32_t hashFunction(string_view key) {
+        uint64_t hash = 5381;
+        for (char c : key) {
+            hash = ((hash << 5) + hash) + c;
+        }
+        return (uint32_t)((hash * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
+    int home(uint32_t hash) const { return (int)(hash >> shift); }
+
+    int findSlot(string_view key, uint32_t hash) const {
+        int mask = capacity - 1;
+        int i = home(hash);
+        for (int d = 1; distance[i] >= d; d++) {
+            if (slots[i].hash == hash && slots[i].key == key) {
+                return i;
+            }
+            i = (i + 1) & mask;
+        }
+        return -1;
+    }
+
+    // Places an entry known to be absent. Returns false if some entry
+    // would end up MAX_DISTANCE from home; the table must then grow and
+    // the entry still in `entry` be placed again.
+    bool place(Slot &entry) {
+        int mask = capacity - 1;
+        int i = home(entry.hash);
+        uint8_t d = 1;
+        while (distance[i] != 0) {
+            if (distance[i] < d) {
+                swap(entry, slots[i]);
+                swap(d, distance[i]);
+            }
+            i = (i + 1) & mask;
+            if (++d == MAX_DISTANCE) {
+                return false;
+            }
+        }
+        slots[i] = move(entry);
+        distance[i] = d;
+        return true;
+    }
+
+    void rehash() {
+        vector<Slot> oldSlots(move(slots));
+        vector<uint8_t> oldDistance(move(distance));
+        capacity *= 2;
+        shift--;
+        slots.assign(capacity, Slot());
+        distance.assign(capacity, 0);
+        for (size_t i = 0; i < oldSlots.size(); i++) {
+            if (oldDistance[i]) {
+                placeGrowing(oldSlots[i]);
+            }
+        }
+    }
+
+    void placeGrowing(Slot &entry) {
+        while (!place(entry)) {
+            rehash();
+        }
+    }
+
+public:
+    FlatHashTable(int initialCapacity = 16) : capacity(8), size(0), shift(29) {
+        while (capacity < initialCapacity) {
+            capacity *= 2;
+            shift--;
+        }
+        slots.resize(capacity);
+        distance.resize(capacity, 0);
+    }
+
+    bool insert(string_view key, int value) {
+        uint32_t hash = hashFunction(key);
+        int existing = findSlot(key, hash);
+        if (existing >= 0) {
+            slots[existing].value = value;
+            return false;
+        }
+
+        if ((double)(size + 1) / capacity > LOAD_FACTOR_THRESHOLD) {
+            rehash();
+        }
+
+        Slot entry{string(key), value, hash};
+        placeGrowing(entry);
+        size++;
+        return true;
+    }
+
+    int* search(string_view key) {
+        int i = findSlot(key, hashFunction(key));
+        return (i >= 0) ? &slots[i].value : nullptr;
+    }
+
+    bool remove(string_view key) {
+        int i = findSlot(key, hashFunction(key));
+        if (i < 0) {
+            return false;
+        }
+        int mask = capacity - 1;
+        for (int next = (i + 1) & mask; distance[next] > 1; next = (next + 1) & mask) {
+            slots[i] = move(slots[next]);
+            distance[i] = distance[next] - 1;
+            i = next;
+        }
+        slots[i].key.clear();
+        distance[i] = 0;
+        size--;
+        return true;
+    }
+
+    int getSize() { return size; }
+    int getCapacity() { return capacity; }
+    double getLoadFactor() { return (double)size / capacity; }
+    bool isEmpty() { return size == 0; }
+
+    // Longest probe sequence any present key needs
+    int getMaxProbeLength() {
+        int longest = 0;
+        for (uint8_t d : distance) longest = max(longest, (int)d);
+        return longest;
+    }
+
+    vector<pair<string, int>> getAllEntries() {
+        vector<pair<string, int>> result;
+        for (int i = 0; i < capacity; i++) {
+            if (distance[i]) {
+                result.push_back({slots[i].key, slots[i].value});
+            }
+        }
+        return result;
+    }
+
+    void printTable() {
+        cout << "Flat Hash Table (Size: " << size << ", Capacity: " << capacity
+             << ", Load Factor: " << getLoadFactor() << ")" << endl;
+        for (int i = 0; i < capacity; i++) {
+            if (distance[i]) {
+                cout << "Slot " << i << ": [" << slots[i].key << ":" << slots[i].value
+                     << "] probe " << distance[i] - 1 << endl;
+            }
+        }
+    }
+};
+
+// ===================================================================
+// DEMONSTRATION & VISUALIZATION FUNCTIONS
+// ===================================================================
+
+void printVector(const vector<string>& vec, const string& label = "") {
+    if (!label.empty()) cout << label << ": ";
+    for (size_t i = 0; i < vec.size(); i++) {
+        cout << vec[i];
+        if (i < vec.size() - 1) cout << " -> ";
+    }
+    cout << endl;
+}
+
+void printPath(const vector<string>& path, int distance) {
+    cout << "Path: ";
+    printVector(path);
+    cout << "Distance: " << distance << endl;
+}
+
+void printRouteExplanation(const PathResult& path) {
+    for (size_t i = 0; i < path.legCount(); i++) {
+        cout << "  " << path.nameAt(i) << " -> " << path.nameAt(i + 1)
+             << ": " << path.legCosts[i]
+             << " (total " << path.prefixDist[i + 1] << ")" << endl;
+    }
+}
+
+string formatTime(int seconds) {
+    int h = seconds / 3600;
+    int m = (seconds / 60) % 60;
+    string out;
+    out += char('0' + h / 10);
+    out += char('0' + h % 10);
+    out += ':';
+    out += char('0' + m / 10);
+    out += char('0' + m % 10);
+    return out;
+}
+
+void printJourney(const TransitRouter& router, const Journey& j) {
+    cout << "Depart " << formatTime(j.departure) << ", arrive " << formatTime(j.arrival)
+         << ", " << j.transfers << " transfer(s)" << endl;
+    for (auto& leg : j.legs) {
+        cout << "  " << router.nameOf(leg.route) << ": " << router.nameOf(leg.fromStop)
+             << " " << formatTime(leg.departure) << " -> " << router.nameOf(leg.toStop)
+             << " " << formatTime(leg.arrival) << endl;
+    }
+}
+
+void demonstrateHashMap() {
+    cout << "\n=== HASH MAP DEMONSTRATION ===" << endl;
+    UserSystem us;
+    
+    us.addUser("U001", "Alice");
+    us.addUser("U002", "Bob");
+    us.addUser("U003", "Charlie");
+    
+    cout << "Added 3 users" << endl;
+    cout << "Total users: " << us.size() << endl;
+    
+    User* found = us.findUser("U002");
+    if (found) {
+        cout << "Found user: " << found->name << endl;
+    }
+    
+    us.removeUser("U001");
+    cout << "After removal, total users: " << us.size() << endl;
+}
+
+void demonstrateTrie() {
+    cout << "\n=== TRIE DEMONSTRATION ===" << endl;
+    Trie trie;
+    
+    trie.insert("Mumbai");
+    trie.insert("Delhi");
+    trie.insert("Bangalore");
+    trie.insert("Chennai");
+    trie.insert("Mysore");
+    
+    cout << "Inserted: Mumbai, Delhi, Bangalore, Chennai, Mysore" << endl;
+    
+    vector<string> suggestions = trie.suggest("M");
+    cout << "Suggestions for 'M': ";
+    printVector(suggestions);
+    
+    suggestions = trie.suggest("Ban");
+    cout << "Suggestions for 'Ban': ";
+    printVector(suggestions);
+
+    cout << "Interned spellings for 'm': ";
+    for (Symbol sym : trie.suggestSymbols("m")) {
+        cout << trie.nameOf(sym) << " (#" << sym << ") ";
+    }
+    cout << endl;
+
+    // Popularity scores: re-inserting a word updates its score
+    trie.insert("Mumbai", 95);
+    trie.insert("Mysore", 40);
+    trie.insert("Madurai", 60);
+    trie.insert("Manali", 70);
+    trie.insert("Mangalore", 20);
+    cout << "Top 3 for 'M' by popularity: ";
+    printVector(trie.suggest("M", 3));
+    trie.insert("Mumbai", 10);
+    cout << "After Mumbai drops to 10: ";
+    printVector(trie.suggest("M", 3));
+    trie.remove("Manali");
+    cout << "After removing Manali: ";
+    printVector(trie.suggest("M", 3));
+
+    // UTF-8 keys with case folding; digits kept, punctuation ignored
+    trie.insert("São Paulo");
+    trie.insert("St. John's");
+    trie.insert("42nd Street");
+    trie.insert("Москва");
+    cout << "Suggestions for 'SÃO': ";
+    printVector(trie.suggest("SÃO"));
+    cout << "Suggestions for 'st j': ";
+    printVector(trie.suggest("st j"));
+    cout << "Suggestions for '42': ";
+    printVector(trie.suggest("42"));
+    cout << "Suggestions for 'МОС': ";
+    printVector(trie.suggest("МОС"));
+
+    // Typo-tolerant: the best matches within 1-2 edits of the prefix
+    cout << "Suggestions for 'Mumbia': ";
+    printVector(trie.suggest("Mumbia"));
+    cout << "Fuzzy (1 edit) for 'Mumbia': ";
+    printVector(trie.suggestFuzzy("Mumbia", 1, 3));
+    cout << "Fuzzy (2 edits) for 'Chenai': ";
+    printVector(trie.suggestFuzzy("Chenai", 2, 3));
+    cout << "Fuzzy (1 edit) for 'МАСКВА': ";
+    printVector(trie.suggestFuzzy("МАСКВА", 1, 3));
+
+    // Frozen read-only copy serving the same suggestions
+    string frozen = LoudsTrie::build(trie);
+    LoudsTrie louds;
+    louds.attach(frozen.data(), frozen.size());
+    cout << "LOUDS trie: " << louds.nodeCount() << " nodes in " << louds.sizeBytes()
+         << " bytes; same suggestions for 'm': " << (louds.suggest("m") == trie.suggest("m") ? "Yes" : "No") << endl;
+    // A truncated buffer, or a section offset past the end, is refused
+    string truncated = frozen.substr(0, frozen.size() - 8);
+    string corrupt = frozen;
+    uint64_t badOffset = corrupt.size();
+    memcpy(&corrupt[8 + 7 * sizeof(uint64_t)], &badOffset, sizeof(badOffset));  // loudsOff
+    LoudsTrie rejected;
+    cout << "Truncated or corrupt LOUDS buffer refused: "
+         << (!rejected.attach(truncated.data(), truncated.size()) && !rejected.attach(corrupt.data(), corrupt.size())
+             ? "Yes" : "No") << endl;
+}
+
+void demonstrateInfixIndex() {
+    cout << "\n=== INFIX INDEX DEMONSTRATION ===" << endl;
+    InfixIndex index;
+    index.add("Grand Central Station", 90);
+    index.add("Central Park", 80);
+    index.add("Central Avenue", 30);
+    index.add("Park Avenue", 60);
+    index.add("Mumbai Central", 50);
+    index.add("Chhatrapati Shivaji Terminus", 70);
+
+    cout << "Indexed: Grand Central Station, Central Park, Central Avenue, Park Avenue, Mumbai Central, "
+         << "Chhatrapati Shivaji Terminus" << endl;
+    cout << "Matches for 'central': ";
+    printVector(index.search("central"));
+    cout << "Top 2 for 'AVENUE': ";
+    printVector(index.search("AVENUE", 2));
+    cout << "Matches for 'shivaji term': ";
+    printVector(index.search("shivaji term"));
+    cout << "Matches for 'rk': ";
+    printVector(index.search("rk"));
+}
+
+void demonstrateGraph() {
+    cout << "\n=== GRAPH DEMONSTRATION ===" << endl;
+    Graph g;
+    
+    g.addLocation("Mumbai");
+    g.addLocation("Delhi");
+    g.addLocation("Bangalore");
+    g.addLocation("Chennai");
+    
+    g.addEdge("Mumbai", "Delhi", 1400);
+    g.addEdge("Mumbai", "Bangalore", 850);
+    g.addEdge("Delhi", "Bangalore", 2150);
+    g.addEdge("Bangalore", "Chennai", 350);
+    
+    cout << "Graph: " << g.getNodeCount() << " nodes, " << g.getEdgeCount() << " edges" << endl;
+    
+    vector<string> bfs = g.BFS("Mumbai");
+    cout << "BFS from Mumbai: ";
+    printVector(bfs);
+    
+    vector<string> dfs = g.DFS("Mumbai");
+    cout << "DFS from Mumbai: ";
+    printVector(dfs);
+    
+    vector<string> path;
+    int dist;
+    if (g.shortestPath("Mumbai", "Chennai", path, dist)) {
+        cout << "Shortest path (Dijkstra's): ";
+        printPath(path, dist);
+    }
+
+    PathResult legs;
+    if (g.shortestPath(g.findLocation("Delhi"), g.findLocation("Chennai"), legs)) {
+        cout << "Route explanation Delhi -> Chennai:" << endl;
+        printRouteExplanation(legs);
+    }
+
+    // Suggest-then-route: each name's node id rides along as the trie
+    // payload, so the picked suggestions go straight to shortestPath. A
+    // place's road count stands in for its popularity.
+    Trie places;
+    vector<uint32_t> roads(g.getNodeCount(), 0);
+    g.forEachEdge([&](int u, int v, int) {
+        roads[u]++;
+        roads[v]++;
+    });
+    for (int id = 0; id < g.getNodeCount(); id++) {
+        places.insert(string(g.getLocationName(id)), roads[id], id);
+    }
+    vector<TrieMatch> from = places.suggestTopMatches("mu", 1);
+    vector<TrieMatch> to = places.suggestFuzzyMatches("chenai", 1, 1);
+    if (!from.empty() && !to.empty() && g.shortestPath(from[0].payload, to[0].payload, legs)) {
+        cout << "'mu' -> 'chenai' picks node " << from[0].payload << " -> node " << to[0].payload
+             << ", distance " << legs.totalDistance() << " over " << legs.legCount() << " legs" << endl;
+    }
+}
+
+void demonstrateLinkedList() {
+    cout << "\n=== LINKED LIST DEMONSTRATION ===" << endl;
+    BusRouteManager brm;
+    
+    brm.addRoute("Route101");
+    brm.addStopToRoute("Route101", "Stop1");
+    brm.addStopToRoute("Route101", "Stop2");
+    brm.addStopToRoute("Route101", "Stop3");
+    
+    vector<string> stops = brm.getRouteStops("Route101");
+    cout << "Route stops: ";
+    printVector(stops);
+    
+    brm.reverseRoute("Route101");
+    stops = brm.getRouteStops("Route101");
+    cout << "After reverse: ";
+    printVector(stops);
+
+    brm.addRoute("Route202");
+    brm.addStopToRoute("Route202", "Stop4");
+    brm.addStopToRoute("Route202", "Stop2");
+    cout << "Routes serving Stop2: ";
+    for (auto& ref : brm.getRoutesServingStop("Stop2")) {
+        cout << brm.routeNameOf(ref.route) << " (position " << brm.stopPosition(ref.route, ref.stop) << ") ";
+    }
+    cout << endl;
+
+    brm.addStopToRoute("Route101", "Stop0");
+    cout << "Appended Stop0 to the reversed route: ";
+    printVector(brm.getRouteStops("Route101"));
+    cout << "Read backward without reversing: ";
+    printVector(brm.getRouteStops("Route101", true));
+    brm.insertStopAfter("Route101", "Stop2", "Stop2a");
+    cout << "Inserted Stop2a after Stop2: ";
+    printVector(brm.getRouteStops("Route101"));
+
+    // Handles carry a generation, so one kept past its route's deletion is
+    // rejected even after the slot is reused
+    RouteHandle stale = brm.findRoute("Route202");
+    brm.deleteRoute("Route202");
+    brm.addRoute("Route303");
+    cout << "Handle to deleted Route202 still valid after slot reuse: "
+         << (brm.isValid(stale) ? "Yes" : "No") << endl;
+    cout << "Routes serving Stop1: ";
+    for (auto& ref : brm.getRoutesServingStop("Stop1")) {
+        cout << brm.routeNameOf(ref.route) << " (position " << brm.stopPosition(ref.route, ref.stop) << ") ";
+    }
+    cout << endl;
+}
+
+void demonstrateTransitRouting() {
+    cout << "\n=== TRANSIT ROUTING (RAPTOR) DEMONSTRATION ===" << endl;
+    BusRouteManager brm;
+    Timetable tt;
+
+    brm.addRoute("Blue");
+    for (string s : {"Airport", "Central", "Harbor"}) brm.addStopToRoute("Blue", s);
+    brm.addRoute("Red");
+    for (string s : {"Central", "Market", "University"}) brm.addStopToRoute("Red", s);
+    brm.addRoute("Express");
+    for (string s : {"Airport", "University"}) brm.addStopToRoute("Express", s);
+
+    for (int t = 8 * 3600; t < 10 * 3600; t += 900) {
+        tt.addTrip("Blue", {t, t + 600, t + 1200});
+        tt.addTrip("Red", {t + 300, t + 900, t + 1500});
+    }
+    tt.addTrip("Express", {9 * 3600, 9 * 3600 + 1200});
+
+    TransitRouter router;
+    router.build(brm, tt);
+    cout << "Routes: " << router.getRouteCount() << ", stops: " << router.getStopCount()
+         << ", trips: " << tt.tripCount() << endl;
+
+    vector<Journey> journeys = router.paretoJourneys("Airport", "University", 8 * 3600 + 1200);
+    cout << "Airport -> University after 08:20 (Pareto set):" << endl;
+    for (auto& j : journeys) {
+        printJourney(router, j);
+    }
+}
+
+void demonstrateQueue() {
+    cout << "\n=== QUEUE DEMONSTRATION ===" << endl;
+    TrafficManager tm;
+    
+    tm.pushUpdate(TrafficUpdate("Route1", HIGH));
+    tm.pushUpdate(TrafficUpdate("Route2", MEDIUM));
+    tm.pushUpdate(TrafficUpdate("Route3", LOW));
+    
+    cout << "Queue size: " << tm.queueSize() << endl;
+    int processed = tm.processUpdates();
+    cout << "Processed " << processed << " updates" << endl;
+    cout << "Queue empty: " << (tm.isEmpty() ? "Yes" : "No") << endl;
+
+    TrafficRouteId route1 = tm.routeId("Route1");
+    for (int i = 0; i < 500; i++) {
+        tm.pushUpdate(route1, (TrafficLevel)(1 + i % 3));
+    }
+    tm.pushUpdate(TrafficUpdate("Route2", HIGH));
+    DrainStats stats = tm.drainUpdates();
+    cout << "Burst of 501 updates: drained " << stats.drained << ", applied " << stats.applied
+         << ", coalesced " << stats.coalesced << endl;
+
+    for (int i = 0; i < 1000; i++) {
+        tm.pushUpdate(TrafficUpdate("Refresh" + to_string(i % 100), LOW));
+    }
+    tm.pushUpdate(TrafficUpdate("Route3", HIGH));
+    long highBefore = tm.getLevelStats(HIGH).drained;
+    tm.drainUpdates(1);
+    cout << "HIGH alert behind 1000 LOW refreshes drained first: "
+         << (tm.getLevelStats(HIGH).drained == highBefore + 1 ? "Yes" : "No") << endl;
+    tm.processUpdates();
+    const char* levelNames[] = {"LOW", "MEDIUM", "HIGH"};
+    for (int lvl = LOW; lvl <= HIGH; lvl++) {
+        LevelStats ls = tm.getLevelStats((TrafficLevel)lvl);
+        cout << levelNames[lvl - 1] << ": " << ls.drained << " drained, avg delay "
+             << (long)(ls.averageDelayNs() / 1000) << " us, max " << ls.maxDelayNs / 1000
+             << " us, " << ls.deadlineMisses << " deadline misses" << endl;
+    }
+
+    TrafficLevel level;
+    if (tm.getTrafficLevel("Route3", level)) {
+        cout << "Route3 is now " << levelNames[level - 1] << endl;
+    }
+    cout << "Unknown route has a level: " << (tm.getTrafficLevel("Route99", level) ? "Yes" : "No") << endl;
+    TrafficSnapshot snap = tm.snapshot();
+    TrafficLevel snapLevel;
+    cout << "Snapshot at version " << snap.version << " agrees on Route2: "
+         << (snap.get(tm.routeId("Route2"), snapLevel) && tm.getTrafficLevel("Route2", level)
+             && snapLevel == level ? "Yes" : "No") << endl;
+}
+
+void demonstrateTrafficHistory() {
+    cout << "\n=== TRAFFIC HISTORY DEMONSTRATION ===" << endl;
+    TrafficHistory history;
+    Symbol route = sharedInterner().intern("Route1");
+
+    // One day sampled every 5 minutes: congested 08:00-10:00 and 17:00-19:00
+    const uint64_t day = 1700000000 / 86400 * 86400;
+    for (int t = 0; t < 86400; t += 300) {
+        int hour = t / 3600;
+        TrafficLevel level = LOW;
+        if ((hour >= 8 && hour < 10) || (hour >= 17 && hour < 19)) level = HIGH;
+        else if (hour >= 7 && hour < 20) level = MEDIUM;
+        history.append(route, day + t, level);
+    }
+
+    cout << "Stored " << history.sampleCount() << " samples in " << history.memoryBytes() << " bytes" << endl;
+    LevelSummary rush = history.aggregate(route, day + 8 * 3600, day + 10 * 3600 - 1);
+    LevelSummary night = history.aggregate(route, day, day + 6 * 3600 - 1);
+    cout << "08:00-10:00 mean level: " << rush.meanLevel() << " (" << rush.total() << " samples)" << endl;
+    cout << "00:00-06:00 mean level: " << night.meanLevel() << " (" << night.total() << " samples)" << endl;
+    cout << "Samples 17:00-17:30: " << history.range(route, day + 17 * 3600, day + 17 * 3600 + 1800).size() << endl;
+
+    // Route1 then goes quiet: a sweep still expires its samples
+    history.evictAll(day + 8 * 86400);
+    cout << "After a quiet week past retention: " << history.sampleCount() << " samples" << endl;
+}
+
+void removeLogFiles(const string &base) {
+    ::unlink((base + ".wal").c_str());
+    ::unlink((base + ".snap").c_str());
+}
+
+void demonstrateWriteAheadLog() {
+    cout << "\n=== WRITE-AHEAD LOG DEMONSTRATION ===" << endl;
+    const string base = "navigatex-demo";
+    removeLogFiles(base);
+    {
+        StringInterner names;
+        Graph graph(names);
+        BusRouteManager routes(names);
+        TrafficManager traffic(1 << 10, WAIT_FOR_SPACE, names);
+        WriteAheadLog wal(base);
+        wal.recover(graph, routes, traffic);
+        graph.attachLog(&wal);
+        routes.attachLog(&wal);
+        traffic.attachLog(&wal);
+
+        graph.addEdge("Home", "Mall", 5);
+        graph.addEdge("Mall", "Office", 3);
+        routes.addRoute("Route1");
+        routes.addStops(routes.findRoute("Route1"), {"Home", "Mall", "Office"});
+        traffic.pushUpdate(TrafficUpdate("Route1", MEDIUM));
+        traffic.processUpdates();
+        wal.checkpoint(graph, routes, traffic);
+
+        // After the snapshot: only these are replayed from the log
+        graph.addEdge("Office", "Park", 2);
+        routes.insertStopAfter("Route1", "Mall", "Library");
+        routes.reverseRoute("Route1");
+        traffic.pushUpdate(TrafficUpdate("Route1", HIGH));
+        traffic.processUpdates();
+        wal.commit();
+        cout << "Logged " << wal.records() << " records with " << wal.syncs() << " syncs" << endl;
+    }
+
+    // Simulated restart: fresh structures rebuilt from disk
+    StringInterner names;
+    Graph graph(names);
+    BusRouteManager routes(names);
+    TrafficManager traffic(1 << 10, WAIT_FOR_SPACE, names);
+    WriteAheadLog wal(base);
+    RecoveryStats stats;
+    wal.recover(graph, routes, traffic, &stats);
+    cout << "Recovered " << stats.snapshotRecords << " snapshot records + "
+         << stats.logRecords << " log records" << endl;
+
+    vector<string> path;
+    int dist;
+    graph.shortestPath("Home", "Park", path, dist);
+    cout << "Home -> Park after restart: " << dist << endl;
+    cout << "Route1 after restart: ";
+    for (auto& stop : routes.getRouteStops("Route1")) cout << stop << " ";
+    cout << endl;
+    TrafficLevel level;
+    cout << "Route1 traffic after restart is HIGH: "
+         << (traffic.getTrafficLevel("Route1", level) && level == HIGH ? "Yes" : "No") << endl;
+
+    // A torn write at the tail is detected by its checksum and dropped
+    graph.attachLog(&wal);
+    graph.addEdge("Park", "Zoo", 4);
+    wal.commit();
+    int fd = ::open(wal.logFile().c_str(), O_WRONLY | O_APPEND);
+    if (fd >= 0) {
+        const char garbage[] = "\x20\x00\x00\x00torn";
+        ::write(fd, garbage, sizeof(garbage) - 1);
+        ::close(fd);
+    }
+    Graph graph2(names);
+    BusRouteManager routes2(names);
+    TrafficManager traffic2(1 << 10, WAIT_FOR_SPACE, names);
+    WriteAheadLog wal2(base);
+    wal2.recover(graph2, routes2, traffic2, &stats);
+    cout << "Torn tail: dropped " << stats.truncatedBytes << " bytes, kept Park-Zoo: "
+         << (graph2.hasLocation("Zoo") ? "Yes" : "No") << endl;
+    removeLogFiles(base);
+}
+
+void demonstrateAVLTree() {
+    cout << "\n=== AVL TREE DEMONSTRATION ===" << endl;
+    AVLTree tree;
+    
+    tree.insert("Mumbai", 100);
+    tree.insert("Delhi", 200);
+    tree.insert("Bangalore", 300);
+    tree.insert("Chennai", 400);
+    tree.insert("Kolkata", 500);
+    
+    cout << "Inserted 5 locations" << endl;
+    cout << "Tree structure:" << endl;
+    tree.printTree();
+    
+    vector<pair<string, int>> sorted = tree.inorderTraversal();
+    cout << "Inorder traversal (sorted): ";
+    for (auto& p : sorted) {
+        cout << p.first << "(" << p.second << ") ";
+    }
+    cout << endl;
+    
+    int* value = tree.search("Bangalore");
+    if (value) {
+        cout << "Found Bangalore: " << *value << endl;
+    }
+}
+
+void demonstrateCustomHashTable() {
+    cout << "\n=== CUSTOM HASH TABLE DEMONSTRATION ===" << endl;
+    CustomHashTable ht(8);
+    
+    ht.insert("Mumbai", 100);
+    ht.insert("Delhi", 200);
+    ht.insert("Bangalore", 300);
+    ht.insert("Chennai", 400);
+    
+    cout << "Inserted 4 entries" << endl;
+    ht.printTable();
+    
+    int* value = ht.search("Delhi");
+    if (value) {
+        cout << "Found Delhi: " << *value << endl;
+    }
+    
+    ht.remove("Chennai");
+    cout << "\nAfter removing Chennai:" << endl;
+    ht.printTable();
+
+    // Same API over one flat slot array
+    FlatHashTable flat(8);
+    flat.insert("Mumbai", 100);
+    flat.insert("Delhi", 200);
+    flat.insert("Bangalore", 300);
+    flat.insert("Chennai", 400);
+    flat.insert("Kolkata", 500);
+    cout << "\nOpen addressing, 5 entries:" << endl;
+    flat.printTable();
+    value = flat.search("Kolkata");
+    if (value) {
+        cout << "Found Kolkata: " << *value << endl;
+    }
+    flat.remove("Delhi");
+    cout << "After removing Delhi (followers shifted back):" << endl;
+    flat.printTable();
+}
+
+// ===================================================================
+// MAIN DEMONSTRATION FUNCTION
+// ===================================================================
+
+void runAllDemonstrations() {
+    cout << "========================================" << endl;
+    cout << "  DSA IMPLEMENTATIONS DEMONSTRATION" << endl;
+    cout << "========================================" << endl;
+    
+    demonstrateHashMap();
+    demonstrateTrie();
+    demonstrateInfixIndex();
+    demonstrateGraph();
+    demonstrateLinkedList();
+    demonstrateTransitRouting();
+    demonstrateQueue();
+    demonstrateTrafficHistory();
+    demonstrateWriteAheadLog();
+    demonstrateAVLTree();
+    demonstrateCustomHashTable();
+    
+    cout << "\n========================================" << endl;
+    cout << "  DEMONSTRATION COMPLETE" << endl;
+    cout << "========================================" << endl;
+}
+
+// ===================================================================
+// BENCHMARKS - run with --bench
+// ===================================================================
+
+// Allocation counting is opt-in for bench builds
+// (-DNAVIGATEX_COUNT_ALLOCATIONS): only then is the global operator new
+// replaced with a counting one. Other builds keep the standard allocator
+// and report allocation counts as unavailable.
+#ifdef NAVIGATEX_COUNT_ALLOCATIONS
+atomic<long> allocationCount(0);
+
+void* operator new(size_t n) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+
+// Out of line so the compiler never pairs an inlined free() with new
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+long allocationsSoFar() { return allocationCount.load(); }
+#else
+long allocationsSoFar() { return -1; }
+#endif
+
+void printAllocations(const char* label, long before, long calls) {
+    cout << "  " << label << ": ";
+    if (before < 0) {
+        cout << "allocations not counted (build with -DNAVIGATEX_COUNT_ALLOCATIONS)" << endl;
+    } else {
+        cout << (double)(allocationsSoFar() - before) / calls << " allocations/call" << endl;
+    }
+}
+
+class BenchTimer {
+private:
+    chrono::steady_clock::time_point start;
+
+public:
+    BenchTimer() : start(chrono::steady_clock::now()) {}
+
+    double elapsedMs() const {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+void printBenchResult(const string& label, double ms, long ops) {
+    cout << "  " << label << ": " << ms << " ms";
+    if (ops > 0) {
+        cout << " (" << (ms * 1e6 / ops) << " ns/op)";
+    }
+    cout << endl;
+}
+
+// Synthetic gazetteer: place names built from common syllables, with
+// about one in four given a street/park suffix
+vector<string> makePlaceNames(int count, unsigned seed) {
+    static const char* syllables[] = {
+        "san", "ta", "mar", "ia", "new", "port", "ville", "burg", "ton", "ham",
+        "ka", "li", "ra", "no", "del", "vi", "ber", "lin", "mo", "sa",
+        "chen", "nai", "ban", "ga", "lore", "my", "sore", "pu", "ne", "west"};
+    static const char* suffixes[] = {" Street", " Park", " Station", " Road"};
+    mt19937 rng(seed);
+    vector<string> out;
+    out.reserve(count);
+    for (int i = 0; i < count; i++) {
+        string name;
+        int parts = 2 + rng() % 3;
+        for (int k = 0; k < parts; k++) name += syllables[rng() % 30];
+        name[0] = toupper(name[0]);
+        if (rng() % 4 == 0) name += suffixes[rng() % 4];
+        out.push_back(name);
+    }
+    return out;
+}
+
+// Multilingual gazetteer: Latin with diacritics, Cyrillic, Greek and
+// numbered streets, in mixed case
+vector<string> makeMultilingualNames(int count, unsigned seed) {
+    static const vector<vector<string>> scripts = {
+        {"são", "paulo", "zü", "rich", "kra", "ków", "mál", "aga", "øre", "sund", "ţâ", "rgu", "łódź", "é", "cole"},
+        {"мос", "ква", "санкт", "петер", "бург", "ново", "сибирск", "каза", "нь", "ки", "ев", "льв", "ів"},
+        {"αθή", "να", "θεσσα", "λονί", "κη", "πά", "τρα", "ηρά", "κλειο", "ρό", "δος"},
+        {"st", "john", "s", "main", "oak", "elm", "park", "lake", "hill", "view"}};
+    mt19937 rng(seed);
+    vector<string> out;
+    out.reserve(count);
+    for (int i = 0; i < count; i++) {
+        const vector<string> &parts = scripts[rng() % scripts.size()];
+        string name;
+        int n = 2 + rng() % 3;
+        for (int k = 0; k < n; k++) name += parts[rng() % parts.size()];
+        if (rng() % 3 == 0) name = to_string(1 + rng() % 120) + "th " + name;
+        if (rng() % 2 == 0 && (uint8_t)name[0] < 0x80) name[0] = toupper(name[0]);
+        out.push_back(name);
+    }
+    return out;
+}
+
+// Pointer-per-letter node, the layout Trie used before the arena
+struct PointerTrieNode {
+    bool isEnd = false;
+    Symbol word = NO_SYMBOL;
+    PointerTrieNode* children[26] = {};
+};
+
+// The collection Trie::suggest used before: recursive, a new prefix
+// string per visited node
+void collectPointerTrie(PointerTrieNode* node, string prefix, vector<string> &out) {
+    if (node->isEnd) {
+        out.push_back(prefix);
+    }
+    for (int i = 0; i < 26; i++) {
+        if (node->children[i]) {
+            collectPointerTrie(node->children[i], prefix + char('a' + i), out);
+        }
+    }
+}
+
+// Per-keystroke fuzzy top-10: a 3-10 letter prefix of a real name with
+// one letter mistyped
+vector<string> makeTypos(const vector<string> &words, int count, mt19937 &rng) {
+    vector<string> typos;
+    for (int i = 0; i < count; i++) {
+        string q = words[rng() % words.size()].substr(0, 3 + rng() % 8);
+        q[rng() % q.size()] = 'a' + rng() % 26;
+        typos.push_back(q);
+    }
+    return typos;
+}
+
+void benchmarkFuzzy(const Trie &trie, const vector<string> &typos, const string &label) {
+    for (int edits = 1; edits <= 2; edits++) {
+        vector<double> latency;
+        long returned = 0;
+        for (auto& q : typos) {
+            BenchTimer fuzzyTimer;
+            returned += trie.suggestFuzzySymbols(q, edits, 10).size();
+            latency.push_back(fuzzyTimer.elapsedMs());
+        }
+        sort(latency.begin(), latency.end());
+        cout << "  fuzzy top-10" << label << " within " << edits << " edit(s) (" << returned
+             << " results): p50 " << latency[typos.size() / 2] << " ms, p99 "
+             << latency[typos.size() * 99 / 100] << " ms, max " << latency.back() << " ms" << endl;
+    }
+}
+
+void benchmarkTrie() {
+    cout << "\n=== TRIE BENCHMARK ===" << endl;
+    const int WORDS = 300000;
+    const int LOOKUPS = 50000;
+    vector<string> words = makePlaceNames(WORDS, 11);
+    StringInterner names;
+    mt19937 rng(3);
+
+    Trie trie(names);
+    BenchTimer buildTimer;
+    for (auto& w : words) trie.insert(w);
+    printBenchResult("arena insert", buildTimer.elapsedMs(), WORDS);
+
+    vector<unique_ptr<PointerTrieNode>> pointerNodes;
+    pointerNodes.emplace_back(new PointerTrieNode());
+    BenchTimer pointerTimer;
+    for (auto& w : words) {
+        PointerTrieNode* cur = pointerNodes[0].get();
+        for (char c : w) {
+            if (!isalpha(c)) continue;
+            PointerTrieNode* &next = cur->children[tolower(c) - 'a'];
+            if (!next) {
+                pointerNodes.emplace_back(new PointerTrieNode());
+                next = pointerNodes.back().get();
+            }
+            cur = next;
+        }
+        cur->isEnd = true;
+        cur->word = names.intern(w);
+    }
+    printBenchResult("26-pointer insert (baseline)", pointerTimer.elapsedMs(), WORDS);
+
+    double compactMb = trie.memoryBytes() / (1024.0 * 1024.0);
+    double pointerMb = pointerNodes.size() * sizeof(PointerTrieNode) / (1024.0 * 1024.0);
+    cout << "  arena:        " << trie.nodeCount() << " nodes, " << compactMb << " MB ("
+         << compactMb * 5000000 / WORDS / 1024 << " GB for 5M names)" << endl;
+    cout << "  26-pointer:   " << pointerNodes.size() << " nodes, " << pointerMb << " MB ("
+         << pointerMb * 5000000 / WORDS / 1024 << " GB for 5M names, before malloc overhead)" << endl;
+
+    // A handful of names only pays for the first small pages
+    Trie tiny(names);
+    for (int i = 0; i < 4; i++) tiny.insert(words[i]);
+    cout << "  4-name trie:  " << tiny.nodeCount() << " nodes, " << tiny.memoryBytes() << " bytes" << endl;
+
+    vector<const string*> queries;
+    for (int i = 0; i < LOOKUPS; i++) queries.push_back(&words[rng() % WORDS]);
+    long found = 0;
+    BenchTimer lookupTimer;
+    for (const string* q : queries) found += trie.suggestSymbols(*q).size();
+    printBenchResult("arena suggest(full name) (" + to_string(found) + " hits)",
+                     lookupTimer.elapsedMs(), LOOKUPS);
+
+    found = 0;
+    BenchTimer pointerLookupTimer;
+    for (const string* q : queries) {
+        PointerTrieNode* cur = pointerNodes[0].get();
+        for (char c : *q) {
+            if (!isalpha(c)) continue;
+            cur = cur->children[tolower(c) - 'a'];
+            if (!cur) break;
+        }
+        if (cur) {
+            vector<PointerTrieNode*> stack = {cur};
+            while (!stack.empty()) {
+                PointerTrieNode* n = stack.back();
+                stack.pop_back();
+                if (n->isEnd) found++;
+                for (PointerTrieNode* ch : n->children) {
+                    if (ch) stack.push_back(ch);
+                }
+            }
+        }
+    }
+    printBenchResult("26-pointer suggest(full name) (" + to_string(found) + " hits)",
+                     pointerLookupTimer.elapsedMs(), LOOKUPS);
+
+    // Multilingual keys: fan-out reaches dozens of byte values per node,
+    // which a pointer-per-byte node would have to size for 256
+    vector<string> multi = makeMultilingualNames(WORDS, 13);
+    Trie multiTrie(names);
+    BenchTimer multiTimer;
+    for (auto& w : multi) multiTrie.insert(w);
+    printBenchResult("multilingual insert", multiTimer.elapsedMs(), WORDS);
+    double multiMb = multiTrie.memoryBytes() / (1024.0 * 1024.0);
+    cout << "  multilingual: " << multiTrie.nodeCount() << " nodes, " << multiMb << " MB (a 256-pointer node layout: "
+         << multiTrie.nodeCount() * 256.0 * sizeof(void*) / (1024.0 * 1024.0) << " MB)" << endl;
+    found = 0;
+    BenchTimer multiLookupTimer;
+    for (int i = 0; i < LOOKUPS; i++) {
+        const string &w = multi[rng() % WORDS];
+        found += multiTrie.suggestTopSymbols(w, 1).size();
+    }
+    printBenchResult("multilingual top-1 for full name (" + to_string(found) + " hits)",
+                     multiLookupTimer.elapsedMs(), LOOKUPS);
+
+    // Frozen LOUDS copy of the 300k-name trie, saved and memory-mapped
+    const string loudsPath = "navigatex-bench.louds";
+    BenchTimer freezeTimer;
+    LoudsTrie::save(trie, loudsPath);
+    printBenchResult("LOUDS build + save", freezeTimer.elapsedMs(), 0);
+    LoudsTrie louds;
+    BenchTimer openTimer;
+    louds.open(loudsPath);
+    printBenchResult("LOUDS open (mmap)", openTimer.elapsedMs(), 0);
+    cout << "  LOUDS: " << louds.sizeBytes() / (1024.0 * 1024.0) << " MB ("
+         << (louds.sizeBytes() - louds.spellingBytes()) / (1024.0 * 1024.0) << " MB structure + "
+         << louds.spellingBytes() / (1024.0 * 1024.0) << " MB spellings), against " << compactMb
+         << " MB arena + interned spellings" << endl;
+    found = 0;
+    BenchTimer loudsLookupTimer;
+    for (const string* q : queries) found += louds.suggestSpellings(*q).size();
+    printBenchResult("LOUDS suggest(full name) (" + to_string(found) + " hits)",
+                     loudsLookupTimer.elapsedMs(), LOOKUPS);
+    ::unlink(loudsPath.c_str());
+
+    // Allocations per suggest() for two-letter prefixes
+    const int SUGGEST_QUERIES = 500;
+    vector<string> shortPrefixes;
+    for (int i = 0; i < SUGGEST_QUERIES; i++) {
+        shortPrefixes.push_back(words[rng() % WORDS].substr(0, 2));
+    }
+    long results = 0;
+    long allocsBefore = allocationsSoFar();
+    BenchTimer recursiveTimer;
+    for (auto& p : shortPrefixes) {
+        PointerTrieNode* cur = pointerNodes[0].get();
+        string key;
+        for (char c : p) {
+            cur = cur->children[tolower(c) - 'a'];
+            key.push_back(tolower(c));
+        }
+        vector<string> out;
+        collectPointerTrie(cur, key, out);
+        results += out.size();
+    }
+    double recursiveMs = recursiveTimer.elapsedMs();
+    printAllocations("recursive collect (before)", allocsBefore, SUGGEST_QUERIES);
+    printBenchResult("recursive collect (" + to_string(results / SUGGEST_QUERIES) + " keys/call)",
+                     recursiveMs, SUGGEST_QUERIES);
+
+    results = 0;
+    allocsBefore = allocationsSoFar();
+    BenchTimer vectorTimer;
+    for (auto& p : shortPrefixes) results += trie.suggest(p).size();
+    double vectorMs = vectorTimer.elapsedMs();
+    printAllocations("suggest -> vector<string>", allocsBefore, SUGGEST_QUERIES);
+    printBenchResult("suggest -> vector<string> (" + to_string(results / SUGGEST_QUERIES) + " keys/call)",
+                     vectorMs, SUGGEST_QUERIES);
+
+    SuggestionBuffer buffer;
+    trie.suggest("s", buffer);  // warm the buffer once
+    results = 0;
+    allocsBefore = allocationsSoFar();
+    BenchTimer bufferTimer;
+    for (auto& p : shortPrefixes) {
+        trie.suggest(p, buffer);
+        results += buffer.size();
+    }
+    double bufferMs = bufferTimer.elapsedMs();
+    printAllocations("suggest -> reused SuggestionBuffer", allocsBefore, SUGGEST_QUERIES);
+    printBenchResult("suggest -> SuggestionBuffer (" + to_string(results / SUGGEST_QUERIES) + " keys/call)",
+                     bufferMs, SUGGEST_QUERIES);
+
+    results = 0;
+    BenchTimer loudsSuggestTimer;
+    for (auto& p : shortPrefixes) {
+        louds.suggest(p, buffer);
+        results += buffer.size();
+    }
+    printBenchResult("LOUDS suggest -> SuggestionBuffer (" + to_string(results / SUGGEST_QUERIES) + " keys/call)",
+                     loudsSuggestTimer.elapsedMs(), SUGGEST_QUERIES);
+
+    // Top 10 for one- and two-letter prefixes: best-first against
+    // collecting the whole subtree and partially sorting it
+    Trie scored(names);
+    vector<uint32_t> scores(WORDS);
+    for (int i = 0; i < WORDS; i++) {
+        scores[i] = 1000000 / (1 + rng() % 100000);  // heavy-tailed popularity
+        scored.insert(words[i], scores[i]);
+    }
+    unordered_map<Symbol, uint32_t> scoreOf;
+    for (int i = 0; i < WORDS; i++) scoreOf[names.find(words[i])] = scores[i];
+    const int TOPK_QUERIES = 200;
+    vector<string> prefixes;
+    for (int i = 0; i < TOPK_QUERIES; i++) {
+        const string &w = words[rng() % WORDS];
+        prefixes.push_back(w.substr(0, 1 + i % 2));
+    }
+    long returned = 0;
+    BenchTimer topTimer;
+    for (auto& p : prefixes) returned += scored.suggestTopSymbols(p, 10).size();
+    printBenchResult("top-10 best-first (" + to_string(returned) + " results)", topTimer.elapsedMs(), TOPK_QUERIES);
+
+    returned = 0;
+    BenchTimer sortTimer;
+    for (auto& p : prefixes) {
+        vector<Symbol> all = scored.suggestSymbols(p);
+        size_t k = min<size_t>(10, all.size());
+        partial_sort(all.begin(), all.begin() + k, all.end(),
+                     [&](Symbol a, Symbol b) { return scoreOf[a] > scoreOf[b]; });
+        returned += k;
+    }
+    printBenchResult("top-10 collect all + partial_sort (" + to_string(returned) + " results)",
+                     sortTimer.elapsedMs(), TOPK_QUERIES);
+
+    vector<string> typos = makeTypos(words, 2000, rng);
+    benchmarkFuzzy(scored, typos, "");
+    returned = 0;
+    for (auto& q : typos) returned += scored.suggestTopSymbols(q, 10).size();
+    cout << "  exact top-10 on the same typos: " << returned << " results" << endl;
+
+    // Keystroke to route endpoint: the top suggestion's Graph node id from
+    // the payload, against resolving the suggested spelling by name
+    Graph places(names);
+    Trie located(names);
+    for (int i = 0; i < WORDS; i++) {
+        located.insert(words[i], scores[i], places.addLocation(words[i]));
+    }
+    long idSum = 0;
+    BenchTimer resolveTimer;
+    for (auto& p : prefixes) {
+        for (Symbol sym : located.suggestTopSymbols(p, 1)) idSum += places.findLocation(names.view(sym));
+    }
+    printBenchResult("top-1 then findLocation by name (id sum " + to_string(idSum) + ")",
+                     resolveTimer.elapsedMs(), TOPK_QUERIES);
+    idSum = 0;
+    BenchTimer payloadTimer;
+    for (auto& p : prefixes) {
+        for (const TrieMatch &m : located.suggestTopMatches(p, 1)) idSum += m.payload;
+    }
+    printBenchResult("top-1 with node id payload (id sum " + to_string(idSum) + ")",
+                     payloadTimer.elapsedMs(), TOPK_QUERIES);
+
+    // Removal recycles sibling runs through the free lists, so churn
+    // leaves the arena the size it was
+    double churnMb = trie.memoryBytes() / (1024.0 * 1024.0);
+    BenchTimer removeTimer;
+    for (int i = 0; i < WORDS; i += 2) trie.remove(words[i]);
+    printBenchResult("remove half the names (" + to_string(trie.nodeCount()) + " nodes left)",
+                     removeTimer.elapsedMs(), WORDS / 2);
+    for (int i = 0; i < WORDS; i += 2) trie.insert(words[i]);
+    cout << "  arena after remove + reinsert: " << trie.memoryBytes() / (1024.0 * 1024.0) << " MB (was "
+         << churnMb << " MB)" << endl;
+
+    // Teardown: one release per arena page against one free per node
+    unique_ptr<Trie> doomed(new Trie(names));
+    for (auto& w : words) doomed->insert(w);
+    size_t doomedNodes = doomed->nodeCount();
+    BenchTimer arenaTeardown;
+    doomed.reset();
+    printBenchResult("arena teardown (" + to_string(doomedNodes) + " nodes)", arenaTeardown.elapsedMs(), 0);
+    BenchTimer pointerTeardown;
+    pointerNodes.clear();
+    printBenchResult("26-pointer teardown, one delete per node (baseline)", pointerTeardown.elapsedMs(), 0);
+}
+
+// Readers querying the trie while one ingest thread inserts the second
+// half of the gazetteer. Every reader also checks what it sees: a name
+// whose insert had completed before the query started must be found, and
+// every returned word must really lie under the queried prefix.
+// The fuzzy latency target is set for a national gazetteer, so the same
+// typo workload runs again over 5M names
+void benchmarkFuzzyAtScale() {
+    cout << "\n=== FUZZY SUGGEST AT SCALE ===" << endl;
+    const int WORDS = 5000000;
+    vector<string> words = makePlaceNames(WORDS, 37);
+    StringInterner names;
+    Trie trie(names);
+    mt19937 rng(41);
+    BenchTimer buildTimer;
+    for (int i = 0; i < WORDS; i++) {
+        trie.insert(words[i], 1000000 / (1 + rng() % 100000));
     }
-    
-    AVLNode* deleteHelper(AVLNode* node, string key) {
-        if (!node) return node;
-        
-        if (key < node->key) {
-            node->left = deleteHelper(node->left, key);
-        } else if (key > node->key) {
-            node->right = deleteHelper(node->right, key);
-        } else {
-            if (!node->left || !node->right) {
-                AVLNode* temp = node->left ? node->left : node->right;
-                
-                if (!temp) {
-                    temp = node;
-                    node = nullptr;
-                } else {
-                    *node = *temp;
+    printBenchResult("insert 5M names (" + to_string(trie.nodeCount()) + " nodes, " +
+                     to_string(trie.memoryBytes() / (1024 * 1024)) + " MB)",
+                     buildTimer.elapsedMs(), WORDS);
+    vector<string> typos = makeTypos(words, 2000, rng);
+    benchmarkFuzzy(trie, typos, " over 5M names");
+}
+
+void benchmarkTrieConcurrency() {
+    cout << "\n=== CONCURRENT TRIE BENCHMARK ===" << endl;
+    const int WORDS = 300000;
+    const int PRELOADED = WORDS / 2;
+    vector<string> words = makePlaceNames(WORDS, 17);
+    vector<string> keys(WORDS);
+    for (int i = 0; i < WORDS; i++) appendFoldedKey(words[i], keys[i]);
+    StringInterner names;
+    for (auto& w : words) names.intern(w);
+
+    // The writer either idles, inserts the second half, or churns the top
+    // half of the preloaded words through remove() and insert() so readers
+    // race word slots being cleared. Exact lookups stay on words it leaves
+    // alone (generated names repeat, so churned keys skip any stable one);
+    // readers then skip the full prefix scan and take a deeper top-k, so
+    // more word candidates sit in the frontier while their slot is cleared.
+    // A top-k result that is NO_SYMBOL or off-prefix is a violation.
+    enum Writer { IDLE, INSERTS, CHURN };
+    const int STABLE = PRELOADED / 2;
+    unordered_set<string> stableKeys(keys.begin(), keys.begin() + STABLE);
+    vector<int> churn;
+    for (int i = STABLE; i < PRELOADED; i++) {
+        if (stableKeys.insert(keys[i]).second) churn.push_back(i);
+    }
+    for (int readers : {1, 4}) {
+        for (Writer writing : {IDLE, INSERTS, CHURN}) {
+            Trie trie(names);
+            for (int i = 0; i < PRELOADED; i++) trie.insert(words[i], i);
+            atomic<int> inserted(PRELOADED);
+            atomic<bool> done(false);
+            atomic<long> violations(0);
+            vector<long> queries(readers, 0);
+            vector<thread> threads;
+            BenchTimer timer;
+            for (int t = 0; t < readers; t++) {
+                threads.emplace_back([&, t]() {
+                    mt19937 rng(100 + t);
+                    SuggestionBuffer buffer;
+                    long n = 0;
+                    while (!done.load(memory_order_relaxed)) {
+                        int visible = inserted.load(memory_order_acquire);
+                        int i = rng() % (writing == CHURN ? STABLE : visible);
+                        if (trie.suggestSymbols(words[i]).empty()) violations++;
+                        const string &key = keys[rng() % visible];
+                        string prefix = key.substr(0, 1 + rng() % 3);
+                        if (writing != CHURN) {
+                            trie.suggest(prefix, buffer);
+                            for (size_t r = 0; r < buffer.size(); r++) {
+                                if (buffer[r].substr(0, prefix.size()) != prefix) violations++;
+                            }
+                        }
+                        for (Symbol sym : trie.suggestTopSymbols(prefix, writing == CHURN ? 200 : 10)) {
+                            if (sym == NO_SYMBOL) {
+                                violations++;
+                                continue;
+                            }
+                            string found;
+                            appendFoldedKey(names.view(sym), found);
+                            if (found.compare(0, prefix.size(), prefix) != 0) violations++;
+                        }
+                        if (writing == CHURN) {
+                            for (const TrieMatch &m : trie.suggestTopMatches(prefix, 200)) {
+                                if (m.word == NO_SYMBOL) violations++;
+                            }
+                            n++;
+                        }
+                        n += 3;
+                    }
+                    queries[t] = n;
+                });
+            }
+            BenchTimer writeTimer;
+            long writes = 0;
+            if (writing == INSERTS) {
+                for (int i = PRELOADED; i < WORDS; i++) {
+                    trie.insert(words[i], i);
+                    inserted.store(i + 1, memory_order_release);
                 }
-                delete temp;
+                writes = WORDS - PRELOADED;
+            } else if (writing == CHURN) {
+                for (int round = 0; round < 2; round++) {
+                    for (int i : churn) trie.remove(words[i]);
+                    for (int i : churn) trie.insert(words[i], i);
+                }
+                writes = 4L * churn.size();
             } else {
-                AVLNode* temp = minValueNode(node->right);
-                node->key = temp->key;
-                node->value = temp->value;
-                node->right = deleteHelper(node->right, temp->key);
+                this_thread::sleep_for(chrono::milliseconds(300));
+            }
+            double writeMs = writeTimer.elapsedMs();
+            done = true;
+            for (auto& t : threads) t.join();
+            double ms = timer.elapsedMs();
+            long total = 0;
+            for (long n : queries) total += n;
+            const char *during[] = {", no writer", " during inserts", " during removes"};
+            printBenchResult("queries, " + to_string(readers) + " reader(s)" + during[writing] +
+                             " (" + to_string(violations.load()) + " violations)", ms, total);
+            if (writing == INSERTS) {
+                printBenchResult("  inserts alongside " + to_string(readers) + " reader(s) (" +
+                                 to_string(trie.nodeCount()) + " nodes, " +
+                                 to_string(trie.memoryBytes() / (1024 * 1024)) + " MB)",
+                                 writeMs, writes);
+            } else if (writing == CHURN) {
+                printBenchResult("  removes + reinserts alongside " + to_string(readers) + " reader(s)",
+                                 writeMs, writes);
             }
         }
-        
-        if (!node) return node;
-        
-        node->height = 1 + max(getHeight(node->left), getHeight(node->right));
-        int balance = getBalance(node);
-        
-        if (balance > 1 && getBalance(node->left) >= 0) {
-            return rightRotate(node);
+    }
+}
+
+// Synthetic city: a grid of stops with bidirectional row and column lines
+// plus random cross-town routes, served every 8 minutes from 05:00 to 24:00
+void benchmarkTransitRouting() {
+    cout << "\n=== TRANSIT ROUTING BENCHMARK ===" << endl;
+    const int GRID = 40;
+    const int HEADWAY = 480;
+    StringInterner names;
+    BusRouteManager brm(names);
+    Timetable tt;
+    mt19937 rng(42);
+
+    auto stopName = [](int r, int c) {
+        return "S" + to_string(r) + "_" + to_string(c);
+    };
+
+    vector<vector<pair<int, int>>> lines;
+    for (int i = 0; i < GRID; i++) {
+        vector<pair<int, int>> row, col;
+        for (int j = 0; j < GRID; j++) {
+            row.push_back({i, j});
+            col.push_back({j, i});
         }
-        
-        if (balance > 1 && getBalance(node->left) < 0) {
-            node->left = leftRotate(node->left);
-            return rightRotate(node);
+        lines.push_back(row);
+        lines.push_back(vector<pair<int, int>>(row.rbegin(), row.rend()));
+        lines.push_back(col);
+        lines.push_back(vector<pair<int, int>>(col.rbegin(), col.rend()));
+    }
+    for (int i = 0; i < 80; i++) {
+        vector<pair<int, int>> walk;
+        int r = rng() % GRID, c = rng() % GRID;
+        for (int j = 0; j < 30; j++) {
+            walk.push_back({r, c});
+            if (rng() % 2) r = min(GRID - 1, r + 1); else c = min(GRID - 1, c + 1);
+            if (walk.back() == make_pair(r, c)) break;
         }
-        
-        if (balance < -1 && getBalance(node->right) <= 0) {
-            return leftRotate(node);
+        if (walk.size() >= 2) lines.push_back(walk);
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        string rn = "L" + to_string(i);
+        brm.addRoute(rn);
+        for (auto& stop : lines[i]) {
+            brm.addStopToRoute(rn, stopName(stop.first, stop.second));
         }
-        
-        if (balance < -1 && getBalance(node->right) > 0) {
-            node->right = rightRotate(node->right);
-            return leftRotate(node);
+        for (int start = 5 * 3600 + (int)(rng() % HEADWAY); start < 24 * 3600; start += HEADWAY) {
+            vector<int> times;
+            int t = start;
+            for (size_t p = 0; p < lines[i].size(); p++) {
+                times.push_back(t);
+                t += 90 + rng() % 60;
+            }
+            tt.addTrip(rn, times);
         }
-        
-        return node;
     }
-    
-    AVLNode* searchHelper(AVLNode* node, string key) {
-        if (!node || node->key == key) {
-            return node;
+
+    TransitRouter router(names);
+    BenchTimer buildTimer;
+    router.build(brm, tt);
+    printBenchResult("build (" + to_string(router.getRouteCount()) + " routes, " +
+                     to_string(router.getStopCount()) + " stops, " +
+                     to_string(tt.tripCount()) + " trips)", buildTimer.elapsedMs(), 0);
+
+    const int QUERIES = 2000;
+    vector<pair<string, string>> pairs;
+    vector<int> departs;
+    for (int i = 0; i < QUERIES; i++) {
+        pairs.push_back({stopName(rng() % GRID, rng() % GRID), stopName(rng() % GRID, rng() % GRID)});
+        departs.push_back(6 * 3600 + rng() % (14 * 3600));
+    }
+
+    long journeys = 0;
+    BenchTimer queryTimer;
+    for (int i = 0; i < QUERIES; i++) {
+        journeys += router.paretoJourneys(pairs[i].first, pairs[i].second, departs[i]).size();
+    }
+    printBenchResult("Pareto queries (" + to_string(QUERIES) + ", " + to_string(journeys) +
+                     " journeys)", queryTimer.elapsedMs(), QUERIES);
+}
+
+// 10k routes of 200 stops drawn from 20k distinct stop names
+void benchmarkBusRoutes() {
+    cout << "\n=== BUS ROUTE STORAGE BENCHMARK ===" << endl;
+    const int ROUTES = 10000;
+    const int STOPS = 200;
+    StringInterner names;
+    mt19937 rng(7);
+
+    vector<string> stopNames;
+    vector<Symbol> stopSyms;
+    for (int i = 0; i < 20000; i++) {
+        stopNames.push_back("Stop" + to_string(i));
+        stopSyms.push_back(names.intern(stopNames.back()));
+    }
+    vector<int> picks(ROUTES * STOPS);
+    for (int& p : picks) {
+        p = rng() % stopNames.size();
+    }
+
+    BenchTimer buildTimer;
+    vector<BusRoute> routes(ROUTES);
+    for (int r = 0; r < ROUTES; r++) {
+        for (int i = 0; i < STOPS; i++) {
+            routes[r].addStop(stopSyms[picks[r * STOPS + i]]);
         }
-        
-        if (key < node->key) {
-            return searchHelper(node->left, key);
+    }
+    printBenchResult("BusRoute::addStop (10k x 200)", buildTimer.elapsedMs(), (long)ROUTES * STOPS);
+
+    unsigned long checksum = 0;
+    BenchTimer iterTimer;
+    for (auto& route : routes) {
+        route.forEachStop([&](Symbol s) { checksum += s; });
+    }
+    printBenchResult("BusRoute::forEachStop (10k x 200)", iterTimer.elapsedMs(), (long)ROUTES * STOPS);
+
+    BusRouteManager brm(names);
+    vector<string> routeNames;
+    for (int r = 0; r < ROUTES; r++) {
+        routeNames.push_back("R" + to_string(r));
+        brm.addRoute(routeNames.back());
+    }
+
+    // The lookup BusRouteManager did before handles: by-value strings and
+    // find() followed by operator[] on a map keyed by std::string. Neither
+    // it nor the manager rows below maintain a stop-to-routes index while
+    // appending; the manager builds its index on the first query.
+    unordered_map<string, BusRoute> byValue;
+    for (auto& rn : routeNames) byValue[rn] = BusRoute(rn);
+    auto appendByValue = [&](string rn, string s) {
+        if (byValue.find(rn) == byValue.end()) return false;
+        byValue[rn].addStop(names.intern(s));
+        return true;
+    };
+    BenchTimer byValueTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        for (int i = 0; i < STOPS; i++) {
+            appendByValue(routeNames[r], stopNames[picks[r * STOPS + i]]);
         }
-        
-        return searchHelper(node->right, key);
     }
-    
-    void inorderHelper(AVLNode* node, vector<pair<string, int>> &result) {
-        if (node) {
-            inorderHelper(node->left, result);
-            result.push_back({node->key, node->value});
-            inorderHelper(node->right, result);
+    printBenchResult("before: by-value find + operator[] (baseline)", byValueTimer.elapsedMs(),
+                     (long)ROUTES * STOPS);
+
+    BenchTimer mgrTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        for (int i = 0; i < STOPS; i++) {
+            brm.addStopToRoute(routeNames[r], stopNames[picks[r * STOPS + i]]);
         }
     }
-    
-    void destroyTree(AVLNode* node) {
-        if (node) {
-            destroyTree(node->left);
-            destroyTree(node->right);
-            delete node;
+    printBenchResult("BusRouteManager::addStopToRoute (10k x 200)", mgrTimer.elapsedMs(), (long)ROUTES * STOPS);
+
+    BusRouteManager byHandle(names);
+    vector<RouteHandle> handles;
+    for (int r = 0; r < ROUTES; r++) {
+        byHandle.addRoute(routeNames[r]);
+        handles.push_back(byHandle.findRoute(routeNames[r]));
+    }
+    BenchTimer handleTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        for (int i = 0; i < STOPS; i++) {
+            byHandle.addStopToRoute(handles[r], stopNames[picks[r * STOPS + i]]);
         }
     }
+    printBenchResult("BusRouteManager::addStopToRoute by handle", handleTimer.elapsedMs(), (long)ROUTES * STOPS);
 
-    void printTreeHelper(AVLNode* node, int indent = 0) {
-        if (node) {
-            printTreeHelper(node->right, indent + 4);
-            for (int i = 0; i < indent; i++) cout << " ";
-            cout << node->key << "(" << node->value << ")" << endl;
-            printTreeHelper(node->left, indent + 4);
+    BusRouteManager bulk(names);
+    vector<string_view> batch(STOPS);
+    for (int r = 0; r < ROUTES; r++) {
+        bulk.addRoute(routeNames[r]);
+    }
+    BenchTimer bulkTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        for (int i = 0; i < STOPS; i++) {
+            batch[i] = stopNames[picks[r * STOPS + i]];
         }
+        bulk.addStops(bulk.findRoute(routeNames[r]), batch);
     }
+    printBenchResult("BusRouteManager::addStops (bulk names)", bulkTimer.elapsedMs(), (long)ROUTES * STOPS);
 
-public:
-    AVLTree() : root(nullptr) {}
-    
-    ~AVLTree() {
-        destroyTree(root);
+    BusRouteManager bulkSymbols(names);
+    vector<Symbol> symbolBatch(STOPS);
+    for (int r = 0; r < ROUTES; r++) {
+        bulkSymbols.addRoute(routeNames[r]);
     }
-    
-    void insert(string key, int value) {
-        root = insertHelper(root, key, value);
+    BenchTimer symbolTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        for (int i = 0; i < STOPS; i++) {
+            symbolBatch[i] = stopSyms[picks[r * STOPS + i]];
+        }
+        bulkSymbols.addStops(bulkSymbols.findRoute(routeNames[r]), symbolBatch.data(), STOPS);
     }
-    
-    bool remove(string key) {
-        if (!search(key)) return false;
-        root = deleteHelper(root, key);
-        return true;
+    printBenchResult("BusRouteManager::addStops (bulk symbols)", symbolTimer.elapsedMs(), (long)ROUTES * STOPS);
+
+    BenchTimer indexTimer;
+    checksum += brm.getRoutesServingStop(stopNames[0]).size();
+    printBenchResult("first getRoutesServingStop (builds the stop index)", indexTimer.elapsedMs(),
+                     (long)ROUTES * STOPS);
+    BenchTimer servingTimer;
+    for (int i = 0; i < ROUTES; i++) {
+        checksum += brm.getRoutesServingStop(stopNames[picks[i]]).size();
     }
-    
-    int* search(string key) {
-        AVLNode* node = searchHelper(root, key);
-        return node ? &node->value : nullptr;
+    printBenchResult("getRoutesServingStop (10k)", servingTimer.elapsedMs(), ROUTES);
+
+    BenchTimer readTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        checksum += brm.getRouteStopSymbols(routeNames[r]).size();
     }
-    
-    vector<pair<string, int>> inorderTraversal() {
-        vector<pair<string, int>> result;
-        inorderHelper(root, result);
-        return result;
+    printBenchResult("BusRouteManager::getRouteStopSymbols (10k)", readTimer.elapsedMs(), ROUTES);
+
+    BenchTimer visitTimer;
+    for (int r = 0; r < ROUTES; r++) {
+        byHandle.getRoute(handles[r])->forEachStop([&](Symbol s) { checksum += s; });
     }
-    
-    bool isEmpty() {
-        return root == nullptr;
+    printBenchResult("BusRoute::forEachStop via handle (10k)", visitTimer.elapsedMs(), ROUTES);
+    cout << "  (checksum " << checksum << ")" << endl;
+}
+
+// Route editing: 200k random inserts/deletes on a 20k-stop route, against
+// a plain vector that has to search and shift on every edit
+void benchmarkRouteEdits() {
+    cout << "\n=== ROUTE EDIT BENCHMARK ===" << endl;
+    const int STOPS = 20000;
+    const int EDITS = 200000;
+    StringInterner names;
+    mt19937 rng(11);
+
+    vector<Symbol> syms;
+    for (int i = 0; i < STOPS * 2; i++) {
+        syms.push_back(names.intern("Stop" + to_string(i)));
     }
 
-    void printTree() {
-        if (root) {
-            printTreeHelper(root);
+    BusRoute route("Edit");
+    vector<StopHandle> live;
+    vector<Symbol> baseline;
+    for (int i = 0; i < STOPS; i++) {
+        live.push_back(route.addStop(syms[i]));
+        baseline.push_back(syms[i]);
+    }
+
+    BenchTimer editTimer;
+    for (int i = 0; i < EDITS; i++) {
+        size_t pick = rng() % live.size();
+        if (i % 2 == 0) {
+            live.push_back(route.insertAfter(live[pick], syms[STOPS + rng() % STOPS]));
         } else {
-            cout << "(Empty tree)" << endl;
+            route.eraseStop(live[pick]);
+            live[pick] = live.back();
+            live.pop_back();
         }
     }
-};
-
-// ===================================================================
-// CUSTOM HASH TABLE - Hash Table with Chaining
-// Time Complexity: O(1) average, O(n) worst case
-// ===================================================================
+    printBenchResult("BusRoute insertAfter/eraseStop by handle", editTimer.elapsedMs(), EDITS);
 
-struct HashNode {
-    string key;
-    int value;
-    HashNode* next;
-    
-    HashNode(string k, int v) : key(k), value(v), next(nullptr) {}
-};
+    // Every insert lands right after the same stop, so order label gaps run
+    // out there over and over
+    BusRoute hotspot("Hotspot");
+    for (int i = 0; i < STOPS; i++) hotspot.addStop(syms[i]);
+    StopHandle spot = hotspot.findStop(syms[STOPS / 2]);
+    BenchTimer hotspotTimer;
+    for (int i = 0; i < EDITS; i++) {
+        hotspot.insertAfter(spot, syms[STOPS + i % STOPS]);
+    }
+    printBenchResult("BusRoute insertAfter one stop (" + to_string(hotspot.size()) + " stops)",
+                     hotspotTimer.elapsedMs(), EDITS);
 
-class CustomHashTable {
-private:
-    vector<HashNode*> table;
-    int capacity;
-    int size;
-    const double LOAD_FACTOR_THRESHOLD = 0.75;
-    
-    int hashFunction(string key) {
-        unsigned long hash = 5381;
-        for (char c : key) {
-            hash = ((hash << 5) + hash) + c;
+    BenchTimer byNameTimer;
+    for (int i = 0; i < EDITS / 10; i++) {
+        Symbol victim = syms[rng() % (STOPS * 2)];
+        if (route.deleteStop(victim)) {
+            route.addStop(victim);
         }
-        return hash % capacity;
     }
-    
-    void rehash() {
-        int oldCapacity = capacity;
-        capacity *= 2;
-        vector<HashNode*> newTable(capacity, nullptr);
-        
-        for (int i = 0; i < oldCapacity; i++) {
-            HashNode* node = table[i];
-            while (node) {
-                HashNode* next = node->next;
-                int newIndex = hashFunction(node->key);
-                node->next = newTable[newIndex];
-                newTable[newIndex] = node;
-                node = next;
-            }
+    printBenchResult("BusRoute deleteStop by name + append", byNameTimer.elapsedMs(), EDITS / 10);
+
+    BenchTimer vectorTimer;
+    for (int i = 0; i < EDITS / 10; i++) {
+        Symbol at = baseline[rng() % baseline.size()];
+        auto it = find(baseline.begin(), baseline.end(), at);
+        if (i % 2 == 0) {
+            baseline.insert(it + 1, syms[STOPS + rng() % STOPS]);
+        } else {
+            baseline.erase(it);
         }
-        
-        table = newTable;
     }
+    printBenchResult("vector<Symbol> find + insert/erase (baseline)", vectorTimer.elapsedMs(), EDITS / 10);
+    cout << "  (route size " << route.size() << ", baseline size " << baseline.size() << ")" << endl;
+}
 
-public:
-    CustomHashTable(int initialCapacity = 16) : capacity(initialCapacity), size(0) {
-        table.resize(capacity, nullptr);
+// Producers push 2M updates in total while one applier drains: lock-free
+// ring of interned records against a mutex-guarded queue of TrafficUpdate
+void benchmarkTrafficQueue() {
+    cout << "\n=== TRAFFIC QUEUE BENCHMARK ===" << endl;
+    const int TOTAL = 2000000;
+    const int ROUTES = 1000;
+    StringInterner names;
+    vector<string> routeNames;
+    for (int i = 0; i < ROUTES; i++) {
+        routeNames.push_back("Route" + to_string(i));
     }
-    
-    ~CustomHashTable() {
-        for (int i = 0; i < capacity; i++) {
-            HashNode* node = table[i];
-            while (node) {
-                HashNode* next = node->next;
-                delete node;
-                node = next;
-            }
+
+    for (int producers : {1, 2, 4}) {
+        TrafficManager tm(1 << 14, WAIT_FOR_SPACE, names);
+        vector<TrafficRouteId> ids;
+        for (auto& rn : routeNames) {
+            ids.push_back(tm.routeId(rn));
         }
-    }
-    
-    bool insert(string key, int value) {
-        int* existing = search(key);
-        if (existing) {
-            *existing = value;
-            return false;
+
+        BenchTimer timer;
+        vector<thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&, p]() {
+                for (int i = p; i < TOTAL; i += producers) {
+                    tm.pushUpdate(ids[i % ROUTES], (TrafficLevel)(1 + i % 3));
+                }
+            });
         }
-        
-        if ((double)size / capacity >= LOAD_FACTOR_THRESHOLD) {
-            rehash();
+        long applied = 0;
+        while (applied < TOTAL) {
+            int n = tm.processUpdates();
+            if (n == 0) this_thread::yield();
+            applied += n;
         }
-        
-        int index = hashFunction(key);
-        HashNode* newNode = new HashNode(key, value);
-        newNode->next = table[index];
-        table[index] = newNode;
-        size++;
-        
-        return true;
-    }
-    
-    int* search(string key) {
-        int index = hashFunction(key);
-        HashNode* node = table[index];
-        
-        while (node) {
-            if (node->key == key) {
-                return &node->value;
+        for (auto& t : threads) t.join();
+        printBenchResult("MPSC ring, " + to_string(producers) + " producer(s)", timer.elapsedMs(), TOTAL);
+
+        mutex m;
+        queue<TrafficUpdate> baseline;
+        unordered_map<string, TrafficLevel> current;
+        BenchTimer baseTimer;
+        threads.clear();
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&, p]() {
+                for (int i = p; i < TOTAL; i += producers) {
+                    TrafficUpdate u(routeNames[i % ROUTES], (TrafficLevel)(1 + i % 3));
+                    lock_guard<mutex> guard(m);
+                    baseline.push(u);
+                }
+            });
+        }
+        applied = 0;
+        while (applied < TOTAL) {
+            int n = 0;
+            {
+                lock_guard<mutex> guard(m);
+                while (!baseline.empty()) {
+                    current[baseline.front().routeName] = baseline.front().level;
+                    baseline.pop();
+                    n++;
+                }
             }
-            node = node->next;
+            if (n == 0) this_thread::yield();
+            applied += n;
         }
-        
-        return nullptr;
+        for (auto& t : threads) t.join();
+        printBenchResult("mutex + queue<TrafficUpdate>, " + to_string(producers) + " producer(s)",
+                         baseTimer.elapsedMs(), TOTAL);
     }
-    
-    bool remove(string key) {
-        int index = hashFunction(key);
-        HashNode* node = table[index];
-        HashNode* prev = nullptr;
-        
-        while (node) {
-            if (node->key == key) {
-                if (prev) {
-                    prev->next = node->next;
-                } else {
-                    table[index] = node->next;
+}
+
+// Readers look up random routes while one producer streams updates and
+// the applier drains them
+void benchmarkTrafficReads() {
+    cout << "\n=== TRAFFIC READ BENCHMARK ===" << endl;
+    const int ROUTES = 100000;
+    const int UPDATES = 1000000;
+    const int OTHER_NAMES = 1000000;
+    StringInterner names;
+    // Stops and places named first push the routes' symbols past 1M;
+    // the manager's state still covers only its own routes
+    for (int i = 0; i < OTHER_NAMES; i++) names.intern("Place" + to_string(i));
+    TrafficManager tm(1 << 14, WAIT_FOR_SPACE, names);
+    vector<TrafficRouteId> ids;
+    for (int i = 0; i < ROUTES; i++) {
+        ids.push_back(tm.routeId("Route" + to_string(i)));
+    }
+
+    for (int readers : {1, 2, 4}) {
+        atomic<bool> done(false);
+        vector<long> lookups(readers, 0);
+        vector<thread> threads;
+        BenchTimer timer;
+        for (int t = 0; t < readers; t++) {
+            threads.emplace_back([&, t]() {
+                mt19937 rng(t);
+                TrafficLevel level;
+                long n = 0;
+                while (!done.load(memory_order_relaxed)) {
+                    for (int i = 0; i < 1024; i++) {
+                        tm.getTrafficLevel(ids[rng() % ROUTES], level);
+                    }
+                    n += 1024;
                 }
-                delete node;
-                size--;
-                return true;
+                lookups[t] = n;
+            });
+        }
+        thread producer([&]() {
+            for (int i = 0; i < UPDATES; i++) {
+                tm.pushUpdate(ids[(i * 7919L) % ROUTES], (TrafficLevel)(1 + i % 3));
             }
-            prev = node;
-            node = node->next;
+        });
+        long applied = 0;
+        while (applied < UPDATES) {
+            int n = tm.processUpdates();
+            if (n == 0) this_thread::yield();
+            applied += n;
         }
-        
-        return false;
+        producer.join();
+        done = true;
+        for (auto& t : threads) t.join();
+        long total = 0;
+        for (long n : lookups) total += n;
+        printBenchResult("getTrafficLevel, " + to_string(readers) + " reader(s) during drain",
+                         timer.elapsedMs(), total);
     }
-    
-    int getSize() { return size; }
-    int getCapacity() { return capacity; }
-    double getLoadFactor() { return (double)size / capacity; }
-    bool isEmpty() { return size == 0; }
-    
-    vector<pair<string, int>> getAllEntries() {
-        vector<pair<string, int>> result;
-        for (int i = 0; i < capacity; i++) {
-            HashNode* node = table[i];
-            while (node) {
-                result.push_back({node->key, node->value});
-                node = node->next;
-            }
+
+    const int SNAPSHOTS = 100;
+    size_t known = 0;
+    BenchTimer snapTimer;
+    for (int i = 0; i < SNAPSHOTS; i++) {
+        TrafficSnapshot snap = tm.snapshot();
+        known += count_if(snap.levels.begin(), snap.levels.end(), [](uint8_t l) { return l != 0; });
+    }
+    printBenchResult("snapshot of " + to_string(known / SNAPSHOTS) + " routes", snapTimer.elapsedMs(), SNAPSHOTS);
+    cout << "  snapshot holds " << tm.snapshot().levels.size() << " levels; interner holds "
+         << names.size() << " symbols" << endl;
+}
+
+// Group commit against a sync per record, then restart cost from a long
+// log versus from a snapshot
+void benchmarkWriteAheadLog() {
+    cout << "\n=== WRITE-AHEAD LOG BENCHMARK ===" << endl;
+    const string base = "navigatex-bench";
+    const int RECORDS = 1000000;
+    const int ROUTES = 10000;
+    vector<string> routeNames;
+    for (int i = 0; i < ROUTES; i++) {
+        routeNames.push_back("Route" + to_string(i));
+    }
+
+    removeLogFiles(base);
+    {
+        WriteAheadLog wal(base);
+        BenchTimer timer;
+        for (int i = 0; i < RECORDS; i++) {
+            wal.append(LOG_TRAFFIC, routeNames[i % ROUTES], {}, 1 + i % 3);
+            if (i % 4096 == 4095) wal.commit();
         }
-        return result;
+        wal.commit();
+        printBenchResult("append, commit per 4096 records (" + to_string(wal.syncs()) + " syncs, "
+                         + to_string(wal.logBytes() / RECORDS) + " bytes/record)",
+                         timer.elapsedMs(), RECORDS);
     }
 
-    void printTable() {
-        cout << "Hash Table (Size: " << size << ", Capacity: " << capacity 
-             << ", Load Factor: " << getLoadFactor() << ")" << endl;
-        for (int i = 0; i < capacity; i++) {
-            if (table[i]) {
-                cout << "Bucket " << i << ": ";
-                HashNode* node = table[i];
-                while (node) {
-                    cout << "[" << node->key << ":" << node->value << "]";
-                    if (node->next) cout << " -> ";
-                    node = node->next;
+    const int COMMITS = 2000;
+    removeLogFiles(base + "-sync");
+    {
+        WriteAheadLog wal(base + "-sync");
+        BenchTimer timer;
+        for (int i = 0; i < COMMITS; i++) {
+            wal.commit(wal.append(LOG_TRAFFIC, routeNames[i % ROUTES], {}, 1 + i % 3));
+        }
+        printBenchResult("append + commit each, 1 thread (" + to_string(wal.syncs()) + " syncs)",
+                         timer.elapsedMs(), COMMITS);
+    }
+    removeLogFiles(base + "-sync");
+    for (int writers : {4, 16}) {
+        WriteAheadLog wal(base + "-sync");
+        BenchTimer timer;
+        vector<thread> threads;
+        for (int t = 0; t < writers; t++) {
+            threads.emplace_back([&, t]() {
+                for (int i = t; i < COMMITS; i += writers) {
+                    wal.commit(wal.append(LOG_TRAFFIC, routeNames[i % ROUTES], {}, 1 + i % 3));
                 }
-                cout << endl;
-            }
+            });
         }
+        for (auto& t : threads) t.join();
+        printBenchResult("append + commit each, " + to_string(writers) + " threads ("
+                         + to_string(wal.syncs()) + " syncs)", timer.elapsedMs(), COMMITS);
+        removeLogFiles(base + "-sync");
     }
-};
 
-// ===================================================================
-// DEMONSTRATION & VISUALIZATION FUNCTIONS
-// ===================================================================
+    {
+        StringInterner names;
+        Graph graph(names);
+        BusRouteManager routes(names);
+        TrafficManager traffic(1 << 10, WAIT_FOR_SPACE, names);
+        WriteAheadLog wal(base);
+        RecoveryStats stats;
+        BenchTimer timer;
+        wal.recover(graph, routes, traffic, &stats);
+        printBenchResult("recover from log (" + to_string(stats.logRecords) + " records)",
+                         timer.elapsedMs(), stats.logRecords);
 
-void printVector(const vector<string>& vec, const string& label = "") {
-    if (!label.empty()) cout << label << ": ";
-    for (size_t i = 0; i < vec.size(); i++) {
-        cout << vec[i];
-        if (i < vec.size() - 1) cout << " -> ";
+        BenchTimer checkpointTimer;
+        wal.checkpoint(graph, routes, traffic);
+        printBenchResult("checkpoint", checkpointTimer.elapsedMs(), 0);
     }
-    cout << endl;
-}
+    {
+        StringInterner names;
+        Graph graph(names);
+        BusRouteManager routes(names);
+        TrafficManager traffic(1 << 10, WAIT_FOR_SPACE, names);
+        WriteAheadLog wal(base);
+        RecoveryStats stats;
+        BenchTimer timer;
+        wal.recover(graph, routes, traffic, &stats);
+        printBenchResult("recover from snapshot (" + to_string(stats.snapshotRecords) + " records)",
+                         timer.elapsedMs(), stats.snapshotRecords);
+    }
+    removeLogFiles(base);
 
-void printPath(const vector<string>& path, int distance) {
-    cout << "Path: ";
-    printVector(path);
-    cout << "Distance: " << distance << endl;
+    // Middle edits on one long route whose stop names repeat: logging and
+    // replay name the anchor and its occurrence, so neither renumbers the
+    // route or walks it to a position
+    const int STOPS = 50000;
+    const int EDITS = 100000;
+    vector<string> stopNames;
+    for (int i = 0; i < STOPS / 4; i++) stopNames.push_back("Stop" + to_string(i));
+    vector<string> logged;
+    {
+        StringInterner names;
+        BusRouteManager routes(names);
+        WriteAheadLog wal(base);
+        routes.attachLog(&wal);
+        routes.addRoute("Long");
+        RouteHandle h = routes.findRoute("Long");
+        for (int i = 0; i < STOPS; i++) routes.addStopToRoute(h, stopNames[i % stopNames.size()]);
+        vector<StopHandle> live;
+        const BusRoute* route = routes.getRoute(h);
+        for (StopHandle st = route->firstStop(); st != NO_STOP; st = route->nextStop(st)) live.push_back(st);
+        mt19937 rng(31);
+        BenchTimer timer;
+        for (int i = 0; i < EDITS; i++) {
+            size_t pick = rng() % live.size();
+            if (i % 2 == 0) {
+                live.push_back(routes.insertStopAfter(h, live[pick], stopNames[rng() % stopNames.size()]));
+            } else {
+                routes.eraseStop(h, live[pick]);
+                live[pick] = live.back();
+                live.pop_back();
+            }
+            if (i == EDITS / 2) routes.reverseRoute(h);
+        }
+        wal.commit();
+        printBenchResult("logged insertStopAfter/eraseStop, " + to_string(STOPS) + "-stop route",
+                         timer.elapsedMs(), EDITS);
+        logged = routes.getRouteStops("Long");
+    }
+    {
+        StringInterner names;
+        Graph graph(names);
+        BusRouteManager routes(names);
+        TrafficManager traffic(1 << 10, WAIT_FOR_SPACE, names);
+        WriteAheadLog wal(base);
+        RecoveryStats stats;
+        BenchTimer timer;
+        wal.recover(graph, routes, traffic, &stats);
+        bool same = routes.getRouteStops("Long") == logged;
+        printBenchResult("replay route edits (" + to_string(stats.logRecords) + " records, " +
+                         (same ? "route matches" : "ROUTE DIFFERS") + ")",
+                         timer.elapsedMs(), stats.logRecords);
+    }
+    removeLogFiles(base);
 }
 
-void demonstrateHashMap() {
-    cout << "\n=== HASH MAP DEMONSTRATION ===" << endl;
-    UserSystem us;
-    
-    us.addUser("U001", "Alice");
-    us.addUser("U002", "Bob");
-    us.addUser("U003", "Charlie");
-    
-    cout << "Added 3 users" << endl;
-    cout << "Total users: " << us.size() << endl;
-    
-    User* found = us.findUser("U002");
-    if (found) {
-        cout << "Found user: " << found->name << endl;
+// A week of 5-minute samples for 10k routes; memory is also extrapolated
+// to 100k routes
+void benchmarkTrafficHistory() {
+    cout << "\n=== TRAFFIC HISTORY BENCHMARK ===" << endl;
+    const int ROUTES = 10000;
+    const int WEEK = 7 * 24 * 3600;
+    const int STEP = 300;
+    TrafficHistory history(WEEK);
+    mt19937 rng(5);
+    const uint64_t start = 1700000000;
+
+    BenchTimer appendTimer;
+    long appended = 0;
+    for (int t = 0; t < WEEK; t += STEP) {
+        for (int r = 0; r < ROUTES; r++) {
+            history.append(r, start + t + rng() % 30, (TrafficLevel)(1 + rng() % 3));
+            appended++;
+        }
     }
-    
-    us.removeUser("U001");
-    cout << "After removal, total users: " << us.size() << endl;
-}
+    printBenchResult("append (" + to_string(appended) + " samples)", appendTimer.elapsedMs(), appended);
+    double mb = history.memoryBytes() / (1024.0 * 1024.0);
+    cout << "  memory: " << mb << " MB (" << (history.memoryBytes() / (double)appended)
+         << " bytes/sample, ~" << mb * 10 << " MB for 100k routes)" << endl;
 
-void demonstrateTrie() {
-    cout << "\n=== TRIE DEMONSTRATION ===" << endl;
-    Trie trie;
-    
-    trie.insert("Mumbai");
-    trie.insert("Delhi");
-    trie.insert("Bangalore");
-    trie.insert("Chennai");
-    trie.insert("Mysore");
-    
-    cout << "Inserted: Mumbai, Delhi, Bangalore, Chennai, Mysore" << endl;
-    
-    vector<string> suggestions = trie.suggest("M");
-    cout << "Suggestions for 'M': ";
-    printVector(suggestions);
-    
-    suggestions = trie.suggest("Ban");
-    cout << "Suggestions for 'Ban': ";
-    printVector(suggestions);
-}
+    const int QUERIES = 10000;
+    long found = 0;
+    BenchTimer rangeTimer;
+    for (int i = 0; i < QUERIES; i++) {
+        uint64_t from = start + rng() % (WEEK - 86400);
+        found += history.range(rng() % ROUTES, from, from + 86400).size();
+    }
+    printBenchResult("1-day range queries (" + to_string(found) + " samples)", rangeTimer.elapsedMs(), QUERIES);
 
-void demonstrateGraph() {
-    cout << "\n=== GRAPH DEMONSTRATION ===" << endl;
-    Graph g;
-    
-    g.addLocation("Mumbai");
-    g.addLocation("Delhi");
-    g.addLocation("Bangalore");
-    g.addLocation("Chennai");
-    
-    g.addEdge("Mumbai", "Delhi", 1400);
-    g.addEdge("Mumbai", "Bangalore", 850);
-    g.addEdge("Delhi", "Bangalore", 2150);
-    g.addEdge("Bangalore", "Chennai", 350);
-    
-    cout << "Graph: " << g.getNodeCount() << " nodes, " << g.getEdgeCount() << " edges" << endl;
-    
-    vector<string> bfs = g.BFS("Mumbai");
-    cout << "BFS from Mumbai: ";
-    printVector(bfs);
-    
-    vector<string> dfs = g.DFS("Mumbai");
-    cout << "DFS from Mumbai: ";
-    printVector(dfs);
-    
-    vector<string> path;
-    int dist;
-    if (g.shortestPath("Mumbai", "Chennai", path, dist)) {
-        cout << "Shortest path (Dijkstra's): ";
-        printPath(path, dist);
+    double meanSum = 0;
+    BenchTimer aggTimer;
+    for (int i = 0; i < QUERIES; i++) {
+        uint64_t from = start + rng() % (WEEK - 86400);
+        meanSum += history.aggregate(rng() % ROUTES, from, from + 86400).meanLevel();
     }
-}
+    printBenchResult("1-day aggregates (mean level " + to_string(meanSum / QUERIES) + ")",
+                     aggTimer.elapsedMs(), QUERIES);
 
-void demonstrateLinkedList() {
-    cout << "\n=== LINKED LIST DEMONSTRATION ===" << endl;
-    BusRouteManager brm;
-    
-    brm.addRoute("Route101");
-    brm.addStopToRoute("Route101", "Stop1");
-    brm.addStopToRoute("Route101", "Stop2");
-    brm.addStopToRoute("Route101", "Stop3");
-    
-    vector<string> stops = brm.getRouteStops("Route101");
-    cout << "Route stops: ";
-    printVector(stops);
-    
-    brm.reverseRoute("Route101");
-    stops = brm.getRouteStops("Route101");
-    cout << "After reverse: ";
-    printVector(stops);
+    // Every route goes quiet; a sweep half a week on frees half the blocks
+    long before = history.sampleCount();
+    BenchTimer sweepTimer;
+    history.evictAll(start + WEEK + WEEK / 2);
+    printBenchResult("evictAll over " + to_string(ROUTES) + " routes (" +
+                     to_string(before - history.sampleCount()) + " samples expired)",
+                     sweepTimer.elapsedMs(), ROUTES);
 }
 
-void demonstrateQueue() {
-    cout << "\n=== QUEUE DEMONSTRATION ===" << endl;
-    TrafficManager tm;
-    
-    tm.pushUpdate(TrafficUpdate("Route1", HIGH));
-    tm.pushUpdate(TrafficUpdate("Route2", MEDIUM));
-    tm.pushUpdate(TrafficUpdate("Route3", LOW));
-    
-    cout << "Queue size: " << tm.queueSize() << endl;
-    int processed = tm.processUpdates();
-    cout << "Processed " << processed << " updates" << endl;
-    cout << "Queue empty: " << (tm.isEmpty() ? "Yes" : "No") << endl;
-}
+// Substring queries over a million names: 4-8 letters cut from anywhere
+// in a real name. The baseline folds nothing at query time but still
+// scans every key; both must return the same top 10.
+void benchmarkInfixIndex() {
+    cout << "\n=== INFIX INDEX BENCHMARK ===" << endl;
+    const int NAMES = 1000000;
+    const int QUERIES = 2000;
+    const int SCAN_QUERIES = 20;
+    vector<string> words = makePlaceNames(NAMES, 23);
+    StringInterner names;
+    mt19937 rng(29);
+    vector<uint32_t> scores(NAMES);
+    for (auto& s : scores) s = rng() % 100000;
 
-void demonstrateAVLTree() {
-    cout << "\n=== AVL TREE DEMONSTRATION ===" << endl;
-    AVLTree tree;
-    
-    tree.insert("Mumbai", 100);
-    tree.insert("Delhi", 200);
-    tree.insert("Bangalore", 300);
-    tree.insert("Chennai", 400);
-    tree.insert("Kolkata", 500);
-    
-    cout << "Inserted 5 locations" << endl;
-    cout << "Tree structure:" << endl;
-    tree.printTree();
-    
-    vector<pair<string, int>> sorted = tree.inorderTraversal();
-    cout << "Inorder traversal (sorted): ";
-    for (auto& p : sorted) {
-        cout << p.first << "(" << p.second << ") ";
+    InfixIndex index(names);
+    BenchTimer buildTimer;
+    for (int i = 0; i < NAMES; i++) index.add(words[i], scores[i], i);
+    printBenchResult("add", buildTimer.elapsedMs(), NAMES);
+    cout << "  " << index.trigramCount() << " trigrams, postings " << index.postingBytes() / (1024.0 * 1024.0)
+         << " MB varint (" << index.uncompressedPostingBytes() / (1024.0 * 1024.0) << " MB as 32-bit ids), "
+         << index.memoryBytes() / (1024.0 * 1024.0) << " MB in all" << endl;
+
+    vector<string> queries;
+    for (int i = 0; i < QUERIES; i++) {
+        string key;
+        appendFoldedKey(words[rng() % NAMES], key);
+        size_t len = min<size_t>(key.size(), 4 + rng() % 5);
+        queries.push_back(key.substr(rng() % (key.size() - len + 1), len));
     }
-    cout << endl;
-    
-    int* value = tree.search("Bangalore");
-    if (value) {
-        cout << "Found Bangalore: " << *value << endl;
+
+    // One- and two-letter queries, as typed before a third key press
+    vector<string> shortQueries;
+    for (int i = 0; i < QUERIES; i++) {
+        string key;
+        appendFoldedKey(words[rng() % NAMES], key);
+        size_t len = min<size_t>(key.size(), 1 + rng() % 2);
+        shortQueries.push_back(key.substr(rng() % (key.size() - len + 1), len));
+    }
+
+    for (auto *set : {&queries, &shortQueries}) {
+        vector<double> latency;
+        long returned = 0;
+        for (auto& q : *set) {
+            BenchTimer queryTimer;
+            returned += index.searchMatches(q, 10).size();
+            latency.push_back(queryTimer.elapsedMs());
+        }
+        sort(latency.begin(), latency.end());
+        cout << "  infix top-10, " << (set == &queries ? "4-8" : "1-2") << " byte queries (" << returned
+             << " results): p50 " << latency[QUERIES / 2] << " ms, p99 " << latency[QUERIES * 99 / 100]
+             << " ms, max " << latency.back() << " ms" << endl;
+    }
+
+    vector<string> keys(NAMES);
+    for (int i = 0; i < NAMES; i++) appendFoldedKey(words[i], keys[i]);
+    for (auto *set : {&queries, &shortQueries}) {
+        int mismatches = 0;
+        BenchTimer scanTimer;
+        for (int n = 0; n < SCAN_QUERIES; n++) {
+            const string &q = (*set)[n];
+            vector<pair<uint64_t, int>> hits;
+            for (int i = 0; i < NAMES; i++) {
+                size_t at = keys[i].find(q);
+                if (at != string::npos) hits.push_back({(uint64_t)scores[i] << 32 | (uint32_t)~at, -i});
+            }
+            size_t k = min<size_t>(10, hits.size());
+            partial_sort(hits.begin(), hits.begin() + k, hits.end(), greater<pair<uint64_t, int>>());
+            vector<TrieMatch> got = index.searchMatches(q, 10);
+            bool same = got.size() == k;
+            for (size_t j = 0; same && j < k; j++) same = (int)got[j].payload == -hits[j].second;
+            if (!same) mismatches++;
+        }
+        printBenchResult(string("linear scan top-10, ") + (set == &queries ? "4-8" : "1-2") +
+                             " byte queries (baseline, " + to_string(mismatches) + " mismatches)",
+                         scanTimer.elapsedMs(), SCAN_QUERIES);
     }
 }
 
-void demonstrateCustomHashTable() {
-    cout << "\n=== CUSTOM HASH TABLE DEMONSTRATION ===" << endl;
-    CustomHashTable ht(8);
-    
-    ht.insert("Mumbai", 100);
-    ht.insert("Delhi", 200);
-    ht.insert("Bangalore", 300);
-    ht.insert("Chennai", 400);
-    
-    cout << "Inserted 4 entries" << endl;
-    ht.printTable();
-    
-    int* value = ht.search("Delhi");
-    if (value) {
-        cout << "Found Delhi: " << *value << endl;
+// Hit, miss and delete-heavy workloads over the chained table, the
+// Robin Hood table and std::unordered_map, all keyed by place names
+template <typename Table>
+void benchmarkHashWorkloads(const string &name, Table &table, const vector<string> &keys,
+                            const vector<string> &absent, const vector<string> &churn) {
+    long checksum = 0;
+    BenchTimer insertTimer;
+    for (size_t i = 0; i < keys.size(); i++) table.insert(keys[i], (int)i);
+    printBenchResult(name + " insert", insertTimer.elapsedMs(), keys.size());
+
+    BenchTimer hitTimer;
+    for (auto& k : keys) {
+        if (int* v = table.search(k)) checksum += *v;
     }
-    
-    ht.remove("Chennai");
-    cout << "\nAfter removing Chennai:" << endl;
-    ht.printTable();
+    printBenchResult(name + " search hit", hitTimer.elapsedMs(), keys.size());
+
+    BenchTimer missTimer;
+    for (auto& k : absent) {
+        if (table.search(k)) checksum++;
+    }
+    printBenchResult(name + " search miss", missTimer.elapsedMs(), absent.size());
+
+    // Each step removes one live key and inserts a fresh one
+    BenchTimer churnTimer;
+    for (size_t i = 0; i < churn.size(); i++) {
+        table.remove(keys[i]);
+        table.insert(churn[i], (int)i);
+    }
+    printBenchResult(name + " remove + insert", churnTimer.elapsedMs(), churn.size());
+
+    BenchTimer afterTimer;
+    for (auto& k : keys) {
+        if (int* v = table.search(k)) checksum += *v;
+    }
+    printBenchResult(name + " search removed keys", afterTimer.elapsedMs(), keys.size());
+    cout << "  (" << name << " size " << table.getSize() << ", checksum " << checksum << ")" << endl;
 }
 
-// ===================================================================
-// MAIN DEMONSTRATION FUNCTION
-// ===================================================================
+// std::unordered_map behind the same insert/search/remove calls
+struct StdHashTable {
+    unordered_map<string, int> map;
 
-void runAllDemonstrations() {
-    cout << "========================================" << endl;
-    cout << "  DSA IMPLEMENTATIONS DEMONSTRATION" << endl;
+    void insert(const string &key, int value) { map[key] = value; }
+    int* search(const string &key) {
+        auto it = map.find(key);
+        return (it != map.end()) ? &it->second : nullptr;
+    }
+    void remove(const string &key) { map.erase(key); }
+    int getSize() { return (int)map.size(); }
+};
+
+void benchmarkHashTables() {
+    cout << "\n=== HASH TABLE BENCHMARK ===" << endl;
+    const int KEYS = 500000;
+    vector<string> names = makePlaceNames(3 * KEYS, 31);
+    vector<string> keys, absent, churn;
+    for (int i = 0; i < KEYS; i++) {
+        keys.push_back(names[i] + " " + to_string(i));
+        absent.push_back(names[KEYS + i] + " #" + to_string(i));
+        churn.push_back(names[2 * KEYS + i] + " +" + to_string(i));
+    }
+    mt19937 rng(37);
+    shuffle(keys.begin(), keys.end(), rng);
+
+    {
+        CustomHashTable chained;
+        benchmarkHashWorkloads("chained", chained, keys, absent, churn);
+    }
+    {
+        FlatHashTable flat;
+        benchmarkHashWorkloads("robin hood", flat, keys, absent, churn);
+        cout << "  (robin hood load factor " << flat.getLoadFactor() << ", longest probe "
+             << flat.getMaxProbeLength() << ")" << endl;
+    }
+    {
+        StdHashTable stdMap;
+        benchmarkHashWorkloads("unordered_map", stdMap, keys, absent, churn);
+    }
+}
+
+void runAllBenchmarks() {
     cout << "========================================" << endl;
-    
-    demonstrateHashMap();
-    demonstrateTrie();
-    demonstrateGraph();
-    demonstrateLinkedList();
-    demonstrateQueue();
-    demonstrateAVLTree();
-    demonstrateCustomHashTable();
-    
-    cout << "\n========================================" << endl;
-    cout << "  DEMONSTRATION COMPLETE" << endl;
+    cout << "  BENCHMARKS" << endl;
     cout << "========================================" << endl;
+
+    benchmarkTrie();
+    benchmarkFuzzyAtScale();
+    benchmarkTrieConcurrency();
+    benchmarkInfixIndex();
+    benchmarkBusRoutes();
+    benchmarkRouteEdits();
+    benchmarkTransitRouting();
+    benchmarkTrafficQueue();
+    benchmarkTrafficReads();
+    benchmarkTrafficHistory();
+    benchmarkWriteAheadLog();
+    benchmarkHashTables();
 }
 
 // ===================================================================
 // MAIN FUNCTION
 // ===================================================================
 
-int main() {
-    runAllDemonstrations();
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        runAllBenchmarks();
+    } else {
+        runAllDemonstrations();
+    }
     return 0;
 }